@@ -4,6 +4,17 @@ include("${CMAKE_CURRENT_LIST_DIR}/zar_init.cmake")
 
 set(libraries zar)
 
+# lib/ is not shipped, it must be built from this tree (`zde make` or CMake)
+# so the library matches include/zar.h
+if(NOT EXISTS "${CMAKE_CURRENT_LIST_DIR}/../lib/zar.lib")
+    message(FATAL_ERROR "ZAR: ${CMAKE_CURRENT_LIST_DIR}/../lib/zar.lib not found, build the library first")
+endif()
+
+# the build configuration macros the library was built with, callers must share them
+set(ZAR_LIB_DEFINITIONS)
+include("${CMAKE_CURRENT_LIST_DIR}/../lib/zar-definitions.cmake" OPTIONAL)
+separate_arguments(ZAR_LIB_DEFINITIONS)
+
 foreach(lib ${libraries})
     add_library(${lib} INTERFACE IMPORTED)
 
@@ -11,5 +22,6 @@ foreach(lib ${libraries})
         IMPORTED_LIBNAME "${lib}"
         INTERFACE_INCLUDE_DIRECTORIES "${CMAKE_CURRENT_LIST_DIR}/../include"
         INTERFACE_LINK_DIRECTORIES "${CMAKE_CURRENT_LIST_DIR}/../lib"
+        INTERFACE_COMPILE_DEFINITIONS "${ZAR_LIB_DEFINITIONS}"
     )
 endforeach()
@@ -6,16 +6,31 @@ function(zar_create target)
     set(target_name ${ARGV0})
     list(REMOVE_AT ARGV 0)
 
-    set(ZAR_INPUT)
-    set(ZAR_OUTPUT)
+    set(ZAR_INPUT "")
+    set(ZAR_OUTPUT "")
     set(ZAR_HEADER_SET FALSE)
-    set(ZAR_HEADER)
+    set(ZAR_HEADER "")
+    set(ZAR_RECURSIVE FALSE)
+    set(ZAR_VIDEO FALSE)
+    set(ZAR_CHECKSUM FALSE)
+    set(ZAR_VIDEO_MANIFEST "")
+    set(ZAR_TRACE_FILE "")
+    set(ZAR_PRELOAD "")
     set(current_key)
 
     foreach(arg IN LISTS ARGV)
         if(arg STREQUAL "VERBOSE" OR arg STREQUAL "EXTRACT" OR arg STREQUAL "LIST")
             unset(current_key)
-        elseif(arg STREQUAL "INPUT" OR arg STREQUAL "OUTPUT" OR arg STREQUAL "HEADER")
+        elseif(arg STREQUAL "RECURSIVE")
+            set(ZAR_RECURSIVE TRUE)
+            unset(current_key)
+        elseif(arg STREQUAL "VIDEO")
+            set(ZAR_VIDEO TRUE)
+            unset(current_key)
+        elseif(arg STREQUAL "CHECKSUM")
+            set(ZAR_CHECKSUM TRUE)
+            unset(current_key)
+        elseif(arg STREQUAL "INPUT" OR arg STREQUAL "OUTPUT" OR arg STREQUAL "HEADER" OR arg STREQUAL "VIDEO_MANIFEST" OR arg STREQUAL "TRACE" OR arg STREQUAL "PRELOAD")
             set(current_key ${arg})
             if(arg STREQUAL "HEADER")
                 set(ZAR_HEADER_SET TRUE)
@@ -29,6 +44,15 @@ function(zar_create target)
         elseif(current_key STREQUAL "HEADER")
             set(ZAR_HEADER ${arg})
             unset(current_key)
+        elseif(current_key STREQUAL "VIDEO_MANIFEST")
+            set(ZAR_VIDEO_MANIFEST ${arg})
+            unset(current_key)
+        elseif(current_key STREQUAL "TRACE")
+            set(ZAR_TRACE_FILE ${arg})
+            unset(current_key)
+        elseif(current_key STREQUAL "PRELOAD")
+            set(ZAR_PRELOAD ${arg})
+            unset(current_key)
         else()
             message(FATAL_ERROR "Unknown zar_create argument: ${arg}")
         endif()
@@ -79,7 +103,50 @@ function(zar_create target)
         get_filename_component(header_dir "${ZAR_HEADER}" DIRECTORY)
     endif()
 
-    file(GLOB zar_input_entries CONFIGURE_DEPENDS "${input_abs}/*")
+    set(video_arg)
+    set(video_depends)
+    if(ZAR_VIDEO_MANIFEST)
+        if(NOT IS_ABSOLUTE "${ZAR_VIDEO_MANIFEST}")
+            set(ZAR_VIDEO_MANIFEST "${CMAKE_SOURCE_DIR}/${ZAR_VIDEO_MANIFEST}")
+        endif()
+        set(video_arg -g "${ZAR_VIDEO_MANIFEST}")
+        set(video_depends "${ZAR_VIDEO_MANIFEST}")
+    elseif(ZAR_VIDEO)
+        set(video_arg -g)
+    endif()
+
+    set(trace_arg)
+    set(trace_depends)
+    if(ZAR_TRACE_FILE)
+        if(NOT IS_ABSOLUTE "${ZAR_TRACE_FILE}")
+            set(ZAR_TRACE_FILE "${CMAKE_SOURCE_DIR}/${ZAR_TRACE_FILE}")
+        endif()
+        set(trace_arg -t "${ZAR_TRACE_FILE}")
+        set(trace_depends "${ZAR_TRACE_FILE}")
+    endif()
+
+    set(preload_arg)
+    set(preload_depends)
+    if(ZAR_PRELOAD)
+        if(NOT IS_ABSOLUTE "${ZAR_PRELOAD}")
+            set(ZAR_PRELOAD "${CMAKE_SOURCE_DIR}/${ZAR_PRELOAD}")
+        endif()
+        set(preload_arg -p "${ZAR_PRELOAD}")
+        set(preload_depends "${ZAR_PRELOAD}")
+    endif()
+
+    set(checksum_arg)
+    if(ZAR_CHECKSUM)
+        set(checksum_arg -k)
+    endif()
+
+    set(recursive_arg)
+    if(ZAR_RECURSIVE)
+        set(recursive_arg -r)
+        file(GLOB_RECURSE zar_input_entries CONFIGURE_DEPENDS "${input_abs}/*")
+    else()
+        file(GLOB zar_input_entries CONFIGURE_DEPENDS "${input_abs}/*")
+    endif()
     set(zar_input_files)
     foreach(input_entry IN LISTS zar_input_entries)
         if(NOT IS_DIRECTORY "${input_entry}")
@@ -104,7 +171,12 @@ function(zar_create target)
                 -i "${input_abs}"
                 -o "${output_abs}"
                 ${header_arg}
-        DEPENDS ${zar_input_files} "${ZAR_DIR}/../zar.py"
+                ${recursive_arg}
+                ${video_arg}
+                ${checksum_arg}
+                ${trace_arg}
+                ${preload_arg}
+        DEPENDS ${zar_input_files} ${video_depends} ${trace_depends} ${preload_depends} "${ZAR_DIR}/../zar.py"
         COMMENT "Creating ZAR archive ${output_name_we}"
         VERBATIM
     )
@@ -0,0 +1,29 @@
+# Called by: cmake -DZAR_MAP=<file.map> -DZAR_PROFILE=<profile> -P zar_size.cmake
+#
+# Sums the areas of an sdldz80 map file into code (ROM) and RAM bytes.
+
+cmake_minimum_required(VERSION 3.16)
+
+if(NOT EXISTS "${ZAR_MAP}")
+    message(WARNING "zar_size: map file not found: ${ZAR_MAP}")
+    return()
+endif()
+
+set(ram_areas _DATA _INITIALIZED _BSS _HEAP)
+set(code_size 0)
+set(ram_size 0)
+
+file(STRINGS "${ZAR_MAP}" area_lines REGEX "^_[A-Z0-9_]+[ \t]+[0-9A-Fa-f]+[ \t]+[0-9A-Fa-f]+[ \t]+=[ \t]+[0-9]+\\. bytes")
+foreach(line IN LISTS area_lines)
+    string(REGEX MATCH "^(_[A-Z0-9_]+)[ \t]+[0-9A-Fa-f]+[ \t]+[0-9A-Fa-f]+[ \t]+=[ \t]+([0-9]+)\\." _ "${line}")
+    set(area "${CMAKE_MATCH_1}")
+    set(bytes "${CMAKE_MATCH_2}")
+    if(area IN_LIST ram_areas)
+        math(EXPR ram_size "${ram_size} + ${bytes}")
+    else()
+        math(EXPR code_size "${code_size} + ${bytes}")
+    endif()
+endforeach()
+
+get_filename_component(map_name "${ZAR_MAP}" NAME_WE)
+message(STATUS "${map_name} [${ZAR_PROFILE}]: code ${code_size} bytes, ram ${ram_size} bytes")
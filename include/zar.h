@@ -5,6 +5,46 @@
 #ifndef ZAR_H
 #define ZAR_H
 
+/**
+ * Build configuration
+ *
+ * Define any of these before including zar.h (or pass them with -D) to strip
+ * features out of the library. The library and its callers must be built
+ * with the same set of macros.
+ *
+ *   ZAR_INDEX_ONLY       index based access only, implies ZAR_NO_NAMES,
+ *                        ZAR_NO_BOUNDS_CHECK and ZAR_NO_STREAM (smallest
+ *                        loader build)
+ *   ZAR_NO_NAMES         drop filename lookups, use the `-c` header indexes
+ *   ZAR_NO_BOUNDS_CHECK  trust the caller, skip index and offset validation
+ *   ZAR_NO_STREAM        drop the forward only zar_stream_* reader, and the
+ *                        CLI `s` flag with its ~5KB directory table
+ *   ZAR_NO_VIDEO         drop the direct to VRAM loaders
+ *   ZAR_NO_GROUPS        drop the preload group loader
+ *   ZAR_NO_CHECKSUMS     drop the entry checksum helpers
+ *   ZAR_BUFFER_SIZE      size of the CLI copy buffer, in bytes
+ *
+ * And to add features:
+ *
+ *   ZAR_TRACE            record the order entries are first accessed in,
+ *                        see zar_trace_save()
+ */
+#ifdef ZAR_INDEX_ONLY
+#ifndef ZAR_NO_STREAM
+#define ZAR_NO_STREAM
+#endif
+#ifndef ZAR_NO_NAMES
+#define ZAR_NO_NAMES
+#endif
+#ifndef ZAR_NO_BOUNDS_CHECK
+#define ZAR_NO_BOUNDS_CHECK
+#endif
+#endif
+
+#ifndef ZAR_BUFFER_SIZE
+#define ZAR_BUFFER_SIZE 1024
+#endif
+
 /** Maximum length of the basename (filename without extension) */
 #define ZAR_MAX_BASENAME 8
 
@@ -20,15 +60,63 @@
 /** Value representing an invalid file name */
 #define ZAR_INVALID_NAME 0xFF
 
+/** Latest archive version supported, 0 is flat and 1 adds directories */
+#define ZAR_VERSION 1
+
+/** Entry flag, the entry is a directory */
+#define ZAR_ENTRY_DIR 0x01
+
+/** Archive flag, a video table follows the entries (version 1) */
+#define ZAR_FLAG_VIDEO 0x01
+
+/** Archive flag, a group table follows the entries, video and checksum tables (version 1) */
+#define ZAR_FLAG_GROUPS 0x02
+
+/** Archive flag, a checksum table follows the video table (version 1) */
+#define ZAR_FLAG_CHECKSUMS 0x04
+
+/** Initial value of zar_checksum(), CRC-16/CCITT-FALSE */
+#define ZAR_CHECKSUM_INIT 0xFFFF
+
+/** Maximum length of a group name */
+#define ZAR_MAX_GROUPNAME 8
+
+/** Video entry types, where zar_file_load_vram() places an entry */
+#define ZAR_VIDEO_NONE    0
+#define ZAR_VIDEO_TILESET 1
+#define ZAR_VIDEO_PALETTE 2
+#define ZAR_VIDEO_LAYER0  3
+#define ZAR_VIDEO_LAYER1  4
+
+/** Physical addresses of the Zeal Video Board memories */
+#ifndef ZAR_VRAM_LAYER0
+#define ZAR_VRAM_LAYER0  0x100000UL
+#define ZAR_VRAM_PALETTE 0x100E00UL
+#define ZAR_VRAM_LAYER1  0x101000UL
+#define ZAR_VRAM_TILESET 0x110000UL
+#endif
+
+/** Size of each video memory, an entry must fit in it from its offset */
+#ifndef ZAR_VRAM_LAYER0_SIZE
+#define ZAR_VRAM_LAYER0_SIZE  0x0E00UL
+#define ZAR_VRAM_PALETTE_SIZE 0x0200UL
+#define ZAR_VRAM_LAYER1_SIZE  0x0E00UL
+#define ZAR_VRAM_TILESET_SIZE 0x10000UL
+#endif
+
 typedef char zar_filename[ZAR_MAX_FILENAME + 2];
 
 /**
  * @brief Represents an entry in a ZAR file.
+ *
+ * For directories, `position` is the index of the first child and `size`
+ * the number of children, children are stored contiguously.
  */
 typedef struct {
         uint16_t position;
         uint16_t size;
-        uint16_t cursor;
+        uint16_t cursor; // read offset, relative to the start of the entry
+        uint8_t flags;
 } zar_file_entry_t;
 
 /**
@@ -37,7 +125,17 @@ typedef struct {
 typedef struct {
         zos_dev_t fd;
         uint8_t version;
-        uint8_t file_count;
+        uint8_t file_count; // number of entries, files and directories
+        uint8_t root_count; // entries [0, root_count) form the root directory
+        uint8_t flags;
+#ifndef ZAR_NO_STREAM
+        uint16_t offset; // bytes consumed so far, zar_stream_* only
+#endif
+#ifdef ZAR_TRACE
+        uint8_t trace_count;
+        uint8_t trace[ZAR_MAX_ENTRIES];   // file indexes, in first access order
+        uint8_t traced[(ZAR_MAX_ENTRIES + 7) / 8];
+#endif
 } zar_file_t;
 
 /**
@@ -52,16 +150,176 @@ zos_err_t zar_file_close(zar_file_t* zar_file);
 
 /**
  * @brief Retrieves the contents of a file from a ZAR file entry.
+ *
+ * Reads up to `size` bytes from the entry cursor and advances the cursor.
+ * `size` is updated with the number of bytes read, ERR_NO_MORE_ENTRIES is
+ * returned once the cursor reaches the end of the entry.
  */
 zos_err_t zar_file_read(zar_file_t* zar_file, zar_file_entry_t* entry, uint8_t* buffer, uint16_t* size);
 
+/**
+ * @brief Reads from a ZAR file entry at the given offset.
+ *
+ * Performs a single seek and read, `size` is clamped to the end of the entry.
+ * The entry cursor is left untouched.
+ */
+zos_err_t zar_file_read_at(zar_file_t* zar_file, zar_file_entry_t* entry, uint16_t offset, uint8_t* buffer, uint16_t* size);
+
+/**
+ * @brief Moves the cursor of a ZAR file entry, no I/O is performed.
+ *
+ * `offset` is relative to `whence` and is updated with the new cursor.
+ */
+zos_err_t zar_file_seek(zar_file_entry_t* entry, int32_t* offset, zos_whence_t whence);
+
+/**
+ * @brief Returns the cursor of a ZAR file entry.
+ */
+uint16_t zar_file_tell(const zar_file_entry_t* entry);
+
+/**
+ * @brief Fills `dir` with the root directory of a ZAR file.
+ */
+void zar_file_root(zar_file_t* zar_file, zar_file_entry_t* dir);
+
 /**
  * @brief Retrieves the file entry from a ZAR file by index.
  */
 zos_err_t zar_file_entry_from_index(zar_file_t* zar_file, uint8_t index, zar_file_entry_t *entry);
 
+#ifdef ZAR_TRACE
+/**
+ * @brief Writes the entries accessed so far, in first access order.
+ *
+ * The file is "ZTR", a count byte, then one index byte per entry. Pass it to
+ * `zar.py -t` to lay the data out in that order, indexes are unchanged.
+ */
+zos_err_t zar_trace_save(zar_file_t* zar_file, const char* path);
+#endif // ZAR_TRACE
+
+#ifndef ZAR_NO_VIDEO
+/**
+ * @brief Video metadata of an entry, see ZAR_VIDEO_*
+ */
+typedef struct {
+        uint8_t type;
+        uint16_t offset; // from the start of the video memory of `type`
+} zar_video_t;
+
+/**
+ * @brief Retrieves the video metadata of an entry, ZAR_VIDEO_NONE when the
+ * archive has no video table.
+ */
+zos_err_t zar_file_entry_video(zar_file_t* zar_file, uint8_t index, zar_video_t* video);
+
+/**
+ * @brief Reads a ZAR file entry straight into video memory.
+ *
+ * `window` is a 16KB aligned virtual page owned by the caller, it is
+ * remapped onto the physical pages starting at `address` and left mapped
+ * to the last one. No intermediate buffer is used.
+ */
+zos_err_t zar_file_read_vram(zar_file_t* zar_file, zar_file_entry_t* entry, uint32_t address, void* window);
+
+/**
+ * @brief Loads an entry into video memory using its video metadata.
+ *
+ * Tilesets, palettes and tilemaps are placed in one call, see zar_file_read_vram().
+ * Returns ERR_INVALID_OFFSET if the entry would not fit in its video memory.
+ */
+zos_err_t zar_file_load_vram(zar_file_t* zar_file, uint8_t index, void* window);
+#endif // ZAR_NO_VIDEO
+
+#ifndef ZAR_NO_GROUPS
+/**
+ * @brief A preload group, a named set of entries stored contiguously.
+ */
+typedef struct {
+        uint16_t position;
+        uint16_t size;    // total size of the members
+        uint16_t members; // archive offset of the member records
+        uint8_t count;
+} zar_group_t;
+
+/**
+ * @brief A member of a preload group, once read.
+ */
+typedef struct {
+        uint8_t index;
+        uint16_t size;
+        uint8_t* data; // points into the buffer given to zar_group_read()
+} zar_group_member_t;
+
+/**
+ * @brief Retrieves a preload group from a ZAR file by index.
+ */
+zos_err_t zar_group_from_index(zar_file_t* zar_file, uint8_t index, zar_group_t* group);
+
+#ifndef ZAR_NO_NAMES
+/**
+ * @brief Retrieves a preload group from a ZAR file by name.
+ */
+zos_err_t zar_group_from_name(zar_file_t* zar_file, const char* name, zar_group_t* group);
+#endif
+
+/**
+ * @brief Reads a whole preload group with a single read.
+ *
+ * `size` is the size of `buffer`, it must hold at least `group->size` bytes,
+ * and 3 bytes per member as the member records are read into it first.
+ * `members` must have room for `group->count` entries, each one is filled
+ * with its entry index, size and a pointer to its data in `buffer`.
+ */
+zos_err_t zar_group_read(zar_file_t* zar_file, zar_group_t* group, uint8_t* buffer, uint16_t size, zar_group_member_t* members);
+#endif // ZAR_NO_GROUPS
+
+#ifndef ZAR_NO_CHECKSUMS
+/**
+ * @brief Updates a CRC-16 (CCITT) with `size` bytes of `data`.
+ *
+ * Start from ZAR_CHECKSUM_INIT, the result of a whole entry matches
+ * zar_file_entry_checksum().
+ */
+uint16_t zar_checksum(uint16_t checksum, const uint8_t* data, uint16_t size);
+
+/**
+ * @brief Retrieves the stored checksum of an entry, ERR_NO_SUCH_ENTRY when
+ * the archive has no checksum table.
+ */
+zos_err_t zar_file_entry_checksum(zar_file_t* zar_file, uint8_t index, uint16_t* checksum);
+#endif // ZAR_NO_CHECKSUMS
+
+#ifndef ZAR_NO_STREAM
+/**
+ * @brief Opens a ZAR file for forward only reading, ie: from a serial device.
+ *
+ * No seek is ever performed: read the `file_count` entries with
+ * zar_stream_entry() first, then read the data with zar_stream_read() in
+ * increasing position order. Close it with zar_file_close().
+ */
+zos_err_t zar_stream_open(const char* path, zar_file_t* zar_file);
+
+/**
+ * @brief Reads the next entry of the directory, and its name unless ZAR_NO_NAMES.
+ */
+zos_err_t zar_stream_entry(zar_file_t* zar_file, zar_file_entry_t* entry, zar_filename filename);
+
+/**
+ * @brief Reads the contents of an entry from a forward only ZAR file.
+ *
+ * Bytes between the current offset and the entry cursor are skipped by
+ * reading them into `buffer`. Returns ERR_INVALID_OFFSET if the stream has
+ * already gone past the entry cursor.
+ */
+zos_err_t zar_stream_read(zar_file_t* zar_file, zar_file_entry_t* entry, uint8_t* buffer, uint16_t* size);
+#endif // ZAR_NO_STREAM
+
+#ifndef ZAR_NO_NAMES
 /**
  * @brief Retrieves the file entry from a ZAR file by filename.
+ *
+ * `name` may be a path, ie: "maps/level1.map", each directory along the way
+ * only scans its own entries.
  */
 zos_err_t zar_file_entry_from_name(zar_file_t* zar_file, const char* name, zar_file_entry_t *entry);
 
@@ -71,8 +329,9 @@ zos_err_t zar_file_entry_from_name(zar_file_t* zar_file, const char* name, zar_f
 zos_err_t zar_file_entry_name_of_index(zar_file_t* zar_file, uint8_t index, zar_filename filename);
 
 /**
- * @brief Retrieves the index of a file entry in a ZAR file by filename.
+ * @brief Retrieves the index of a file entry in a ZAR file by filename or path.
  */
 uint8_t zar_file_entry_index_of_name(zar_file_t* zar_file, const char* name);
+#endif // ZAR_NO_NAMES
 
 #endif // ZAR_H
@@ -5,8 +5,14 @@
 
 #include "zar.h"
 
-#define ZAR_FILE_HEADER_SIZE 5
-#define ZAR_ENTRY_SIZE       (sizeof(uint32_t) + ZAR_MAX_FILENAME)
+#define ZAR_FILE_HEADER_SIZE    5
+#define ZAR_FILE_HEADER_SIZE_V1 (ZAR_FILE_HEADER_SIZE + 2)
+#define ZAR_ENTRY_SIZE          (sizeof(uint32_t) + ZAR_MAX_FILENAME)
+#define ZAR_ENTRY_SIZE_V1       (ZAR_ENTRY_SIZE + 1)
+#define ZAR_VIDEO_SIZE          3
+#define ZAR_GROUP_SIZE          (ZAR_MAX_GROUPNAME + 6)
+#define ZAR_GROUP_MEMBER_SIZE   3
+#define ZAR_CHECKSUM_SIZE       2
 
 #define HANDLE_ERROR(error, size, expect)          \
     do {                                           \
@@ -24,17 +30,40 @@ zos_err_t _seek_to_entry_index(zar_file_t* zar_file, uint8_t index)
 {
     // seek to index
     zos_err_t err;
-    uint32_t cursor = ZAR_FILE_HEADER_SIZE + (ZAR_ENTRY_SIZE * index);
+    uint32_t cursor;
+    if (zar_file->version == 0) {
+        cursor = ZAR_FILE_HEADER_SIZE + (ZAR_ENTRY_SIZE * index);
+    } else {
+        cursor = ZAR_FILE_HEADER_SIZE_V1 + (ZAR_ENTRY_SIZE_V1 * index);
+    }
+#ifndef ZAR_NO_BOUNDS_CHECK
     uint32_t pos    = cursor;
+#endif
     err             = seek(zar_file->fd, &cursor, SEEK_SET);
     if (err != ERR_SUCCESS)
         return err;
 
+#ifndef ZAR_NO_BOUNDS_CHECK
     if (pos != cursor)
         return ERR_INVALID_OFFSET;
+#endif
     return ERR_SUCCESS;
 }
 
+// offset of an optional table, they follow the entries as: video, checksums, groups
+uint32_t _table_offset(zar_file_t* zar_file, uint8_t flag)
+{
+    uint32_t offset = ZAR_FILE_HEADER_SIZE_V1 + (ZAR_ENTRY_SIZE_V1 * zar_file->file_count);
+    if (flag != ZAR_FLAG_VIDEO && (zar_file->flags & ZAR_FLAG_VIDEO)) {
+        offset += ZAR_VIDEO_SIZE * zar_file->file_count;
+    }
+    if (flag == ZAR_FLAG_GROUPS && (zar_file->flags & ZAR_FLAG_CHECKSUMS)) {
+        offset += ZAR_CHECKSUM_SIZE * zar_file->file_count;
+    }
+    return offset;
+}
+
+#ifndef ZAR_NO_NAMES
 void _short_name(const char* base, const char* ext, zar_filename filename)
 {
     char* dest  = filename;
@@ -60,6 +89,23 @@ void _short_name(const char* base, const char* ext, zar_filename filename)
     dest[len] = '\0'; // null terminate
 }
 
+uint8_t _index_of_name_in(zar_file_t* zar_file, zar_file_entry_t* dir, const char* name)
+{
+    uint8_t i;
+    uint16_t last = dir->position + dir->size;
+    zar_filename filename;
+
+    for (i = (uint8_t) dir->position; i < last; i++) {
+        zar_file_entry_name_of_index(zar_file, i, filename);
+
+        if (str_cmp(filename, name) == 0) {
+            return i;
+        }
+    }
+    return ZAR_INVALID_NAME;
+}
+#endif // ZAR_NO_NAMES
+
 zos_err_t safe_read(zos_dev_t dev, void* buf, uint16_t* size)
 {
     uint8_t* ptr       = (uint8_t*) buf;
@@ -90,32 +136,76 @@ zos_err_t safe_read(zos_dev_t dev, void* buf, uint16_t* size)
     return err;
 }
 
-/** ZAR Library **/
-
-//
-zos_err_t zar_file_open(const char* path, zar_file_t* zar_file)
+// reads exactly `size` bytes, short reads from character devices are retried
+zos_err_t _read_exact(zos_dev_t dev, void* buf, uint16_t size)
 {
-    zos_err_t err = ERR_SUCCESS;
-    zos_dev_t fd  = open(path, O_RDONLY);
-    if (fd < 0) {
-        return -fd;
+    uint8_t* ptr = (uint8_t*) buf;
+    zos_err_t err;
+    uint16_t chunk;
+
+    while (size > 0) {
+        chunk = size;
+        err   = safe_read(dev, ptr, &chunk);
+        if (err != ERR_SUCCESS)
+            return err;
+        if (chunk == 0)
+            return ERR_ENTRY_CORRUPTED; // truncated
+        ptr  += chunk;
+        size -= chunk;
     }
+    return ERR_SUCCESS;
+}
 
-    zar_file->fd = fd;
+zos_err_t _read_header(zar_file_t* zar_file)
+{
+    zos_err_t err;
+    char header[ZAR_FILE_HEADER_SIZE];
 
     // read the header
-    uint16_t size = ZAR_FILE_HEADER_SIZE;
-    char header[ZAR_FILE_HEADER_SIZE];
-    err = read(fd, header, &size);
-    HANDLE_ERROR(err, size, ZAR_FILE_HEADER_SIZE);
+    err = _read_exact(zar_file->fd, header, ZAR_FILE_HEADER_SIZE);
+    if (err != ERR_SUCCESS)
+        return err;
 
     if ((header[0] != 'Z') || (header[1] != 'A') | (header[2] != 'R')) {
         return ERR_INVALID_FILESYSTEM;
     }
     zar_file->version    = header[3];
     zar_file->file_count = header[4];
+    zar_file->root_count = header[4];
+    zar_file->flags      = 0;
+#ifdef ZAR_TRACE
+    zar_file->trace_count = 0;
+    mem_set(zar_file->traced, 0, sizeof(zar_file->traced));
+#endif
+
+    if (zar_file->version > ZAR_VERSION) {
+        return ERR_NOT_SUPPORTED;
+    }
 
-    return err;
+    if (zar_file->version >= 1) {
+        // root entry count + flags
+        err = _read_exact(zar_file->fd, header, 2);
+        if (err != ERR_SUCCESS)
+            return err;
+        zar_file->root_count = header[0];
+        zar_file->flags      = header[1];
+    }
+
+    return ERR_SUCCESS;
+}
+
+/** ZAR Library **/
+
+//
+zos_err_t zar_file_open(const char* path, zar_file_t* zar_file)
+{
+    zos_dev_t fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -fd;
+    }
+
+    zar_file->fd = fd;
+    return _read_header(zar_file);
 }
 
 zos_err_t zar_file_close(zar_file_t* zar_file)
@@ -129,57 +219,82 @@ zos_err_t zar_file_close(zar_file_t* zar_file)
 
 zos_err_t zar_file_read(zar_file_t* zar_file, zar_file_entry_t* entry, uint8_t* buffer, uint16_t* size)
 {
-    zos_err_t err = ERR_SUCCESS;
+    zos_err_t err = zar_file_read_at(zar_file, entry, entry->cursor, buffer, size);
 
-    if (entry->cursor == 0) {
-        entry->cursor = entry->position;
-    }
-
-    // identify the largest cursor position
-    uint16_t max_cursor = entry->position + entry->size;
-    uint16_t r_size     = *size;
+    // update the cursor to point to the new read position
+    entry->cursor += *size;
+    return err;
+}
 
-    // don't read past the file length
-    if (r_size > entry->size) {
-        r_size = entry->size;
-    }
+zos_err_t zar_file_read_at(zar_file_t* zar_file, zar_file_entry_t* entry, uint16_t offset, uint8_t* buffer, uint16_t* size)
+{
+    zos_err_t err;
 
     // prevent reading past the file
-    if (entry->cursor >= max_cursor) {
+    if (offset >= entry->size) {
         *size = 0;
         return ERR_NO_MORE_ENTRIES; // EOF
     }
 
-    // prevent reading past the file
-    if ((entry->cursor + r_size - 1) >= max_cursor) {
-        r_size = max_cursor - entry->cursor;
+    // don't read past the file length
+    uint16_t remaining = entry->size - offset;
+    if (*size > remaining) {
+        *size = remaining;
     }
 
-    *size            = r_size;
-    uint32_t seek_to = entry->cursor;
-
     // seek to the position within the zar_file
-    err = seek(zar_file->fd, &seek_to, SEEK_SET);
-    if (err != ERR_SUCCESS)
+    uint32_t seek_to = (uint32_t) entry->position + offset;
+    err              = seek(zar_file->fd, &seek_to, SEEK_SET);
+    if (err != ERR_SUCCESS) {
+        *size = 0; // nothing read, the cursor must not move
         return err;
-    entry->cursor = (uint16_t) seek_to;
+    }
 
     // read size bytes into the buffer
-    err = safe_read(zar_file->fd, buffer, size);
-    if (err != ERR_SUCCESS)
-        return err;
+    return safe_read(zar_file->fd, buffer, size);
+}
 
-    // update the cursor to point to the new read position
-    entry->cursor += *size;
-    return err;
+zos_err_t zar_file_seek(zar_file_entry_t* entry, int32_t* offset, zos_whence_t whence)
+{
+    int32_t cursor = *offset;
+    switch (whence) {
+        case SEEK_SET: break;
+        case SEEK_CUR: cursor += entry->cursor; break;
+        case SEEK_END: cursor += entry->size; break;
+        default: return ERR_INVALID_PARAMETER;
+    }
+
+#ifndef ZAR_NO_BOUNDS_CHECK
+    if ((cursor < 0) || (cursor > entry->size))
+        return ERR_INVALID_OFFSET;
+#endif
+
+    entry->cursor = (uint16_t) cursor;
+    *offset       = cursor;
+    return ERR_SUCCESS;
+}
+
+uint16_t zar_file_tell(const zar_file_entry_t* entry)
+{
+    return entry->cursor;
+}
+
+void zar_file_root(zar_file_t* zar_file, zar_file_entry_t* dir)
+{
+    dir->position = 0;
+    dir->size     = zar_file->root_count;
+    dir->cursor   = 0;
+    dir->flags    = ZAR_ENTRY_DIR;
 }
 
 zos_err_t zar_file_entry_from_index(zar_file_t* zar_file, uint8_t index, zar_file_entry_t* entry)
 {
+#ifndef ZAR_NO_BOUNDS_CHECK
     if (index == ZAR_INVALID_NAME)
         return ERR_INVALID_PATH;
     if (index >= zar_file->file_count)
         return ERR_INVALID_OFFSET;
+#endif
 
     uint16_t size;
     zos_err_t err;
@@ -194,10 +309,403 @@ zos_err_t zar_file_entry_from_index(zar_file_t* zar_file, uint8_t index, zar_fil
     HANDLE_ERROR(err, size, sizeof(uint32_t));
 
     entry->cursor = 0;
+    entry->flags  = 0;
+
+    if (zar_file->version >= 1) {
+        size = sizeof(uint8_t);
+        err  = read(zar_file->fd, &entry->flags, &size);
+        HANDLE_ERROR(err, size, sizeof(uint8_t));
+    }
+
+#ifdef ZAR_TRACE
+    // remember the first access of each file
+    uint8_t bit = 1 << (index & 7);
+    if (((entry->flags & ZAR_ENTRY_DIR) == 0) && ((zar_file->traced[index >> 3] & bit) == 0)) {
+        zar_file->traced[index >> 3]             |= bit;
+        zar_file->trace[zar_file->trace_count++] = index;
+    }
+#endif
+
+    return ERR_SUCCESS;
+}
+
+#ifdef ZAR_TRACE
+zos_err_t zar_trace_save(zar_file_t* zar_file, const char* path)
+{
+    zos_err_t err;
+    uint16_t size;
+    char header[4] = {'Z', 'T', 'R', 0};
+
+    zos_dev_t fd = open(path, O_WRONLY | O_CREAT | O_TRUNC);
+    if (fd < 0) {
+        return -fd;
+    }
+
+    header[3] = zar_file->trace_count;
+    size      = sizeof(header);
+    err       = write(fd, header, &size);
+    if (err == ERR_SUCCESS) {
+        size = zar_file->trace_count;
+        err  = write(fd, zar_file->trace, &size);
+    }
+
+    close(fd);
+    return err;
+}
+#endif // ZAR_TRACE
+
+#ifndef ZAR_NO_VIDEO
+zos_err_t zar_file_entry_video(zar_file_t* zar_file, uint8_t index, zar_video_t* video)
+{
+    zos_err_t err;
+    uint8_t record[ZAR_VIDEO_SIZE];
+
+    video->type   = ZAR_VIDEO_NONE;
+    video->offset = 0;
+    if ((zar_file->flags & ZAR_FLAG_VIDEO) == 0)
+        return ERR_SUCCESS;
+
+#ifndef ZAR_NO_BOUNDS_CHECK
+    if (index >= zar_file->file_count)
+        return ERR_INVALID_OFFSET;
+#endif
+
+    uint32_t offset = _table_offset(zar_file, ZAR_FLAG_VIDEO) + (ZAR_VIDEO_SIZE * index);
+    err             = seek(zar_file->fd, &offset, SEEK_SET);
+    if (err != ERR_SUCCESS)
+        return err;
+
+    err = _read_exact(zar_file->fd, record, ZAR_VIDEO_SIZE);
+    if (err != ERR_SUCCESS)
+        return err;
+
+    video->type   = record[0];
+    video->offset = record[1] | (record[2] << 8);
+    return ERR_SUCCESS;
+}
+
+zos_err_t zar_file_read_vram(zar_file_t* zar_file, zar_file_entry_t* entry, uint32_t address, void* window)
+{
+    zos_err_t err;
+    uint16_t remaining = entry->size;
+    uint16_t page_offset;
+    uint16_t chunk;
+
+    uint32_t seek_to = entry->position;
+    err              = seek(zar_file->fd, &seek_to, SEEK_SET);
+    if (err != ERR_SUCCESS)
+        return err;
+
+    // map each physical page into the window and read straight into it
+    while (remaining > 0) {
+        page_offset = (uint16_t) (address & 0x3FFF);
+        chunk       = 0x4000 - page_offset;
+        if (chunk > remaining)
+            chunk = remaining;
+
+        err = map(window, address - page_offset);
+        if (err != ERR_SUCCESS)
+            return err;
+
+        err = _read_exact(zar_file->fd, (uint8_t*) window + page_offset, chunk);
+        if (err != ERR_SUCCESS)
+            return err;
+
+        address   += chunk;
+        remaining -= chunk;
+    }
+
+    return ERR_SUCCESS;
+}
+
+zos_err_t zar_file_load_vram(zar_file_t* zar_file, uint8_t index, void* window)
+{
+    zos_err_t err;
+    uint32_t address;
+    uint32_t limit;
+    zar_video_t video;
+    zar_file_entry_t entry;
+
+    err = zar_file_entry_video(zar_file, index, &video);
+    if (err != ERR_SUCCESS)
+        return err;
+
+    switch (video.type) {
+        case ZAR_VIDEO_TILESET: address = ZAR_VRAM_TILESET; limit = ZAR_VRAM_TILESET_SIZE; break;
+        case ZAR_VIDEO_PALETTE: address = ZAR_VRAM_PALETTE; limit = ZAR_VRAM_PALETTE_SIZE; break;
+        case ZAR_VIDEO_LAYER0: address = ZAR_VRAM_LAYER0; limit = ZAR_VRAM_LAYER0_SIZE; break;
+        case ZAR_VIDEO_LAYER1: address = ZAR_VRAM_LAYER1; limit = ZAR_VRAM_LAYER1_SIZE; break;
+        default: return ERR_NOT_SUPPORTED;
+    }
+
+    err = zar_file_entry_from_index(zar_file, index, &entry);
+    if (err != ERR_SUCCESS)
+        return err;
+
+#ifndef ZAR_NO_BOUNDS_CHECK
+    // never spill into the next video memory
+    if (((uint32_t) video.offset + entry.size) > limit)
+        return ERR_INVALID_OFFSET;
+#else
+    (void) limit;
+#endif
+
+    return zar_file_read_vram(zar_file, &entry, address + video.offset, window);
+}
+#endif // ZAR_NO_VIDEO
+
+#ifndef ZAR_NO_GROUPS
+// seeks to the group table, returns the number of groups in `count`
+zos_err_t _seek_to_groups(zar_file_t* zar_file, uint8_t* count)
+{
+    zos_err_t err;
+
+    if ((zar_file->flags & ZAR_FLAG_GROUPS) == 0)
+        return ERR_NO_SUCH_ENTRY;
+
+    uint32_t offset = _table_offset(zar_file, ZAR_FLAG_GROUPS);
+    err             = seek(zar_file->fd, &offset, SEEK_SET);
+    if (err != ERR_SUCCESS)
+        return err;
+
+    return _read_exact(zar_file->fd, count, sizeof(uint8_t));
+}
+
+// fills `group` from a raw group record, `count` is the number of groups
+void _group_from_record(zar_file_t* zar_file, uint8_t* record, uint8_t count, zar_group_t* group)
+{
+    uint8_t* fields = &record[ZAR_MAX_GROUPNAME];
+
+    mem_cpy(group, fields, sizeof(uint32_t)); // position + size
+    group->count   = fields[5];
+    group->members = _table_offset(zar_file, ZAR_FLAG_GROUPS) + 1
+                   + (ZAR_GROUP_SIZE * count) + (ZAR_GROUP_MEMBER_SIZE * fields[4]);
+}
+
+zos_err_t zar_group_from_index(zar_file_t* zar_file, uint8_t index, zar_group_t* group)
+{
+    zos_err_t err;
+    uint8_t count;
+    uint8_t record[ZAR_GROUP_SIZE];
+
+    err = _seek_to_groups(zar_file, &count);
+    if (err != ERR_SUCCESS)
+        return err;
+
+    if (index >= count)
+        return ERR_INVALID_OFFSET;
+
+    uint32_t offset = ZAR_GROUP_SIZE * index;
+    err             = seek(zar_file->fd, &offset, SEEK_CUR);
+    if (err != ERR_SUCCESS)
+        return err;
+
+    err = _read_exact(zar_file->fd, record, ZAR_GROUP_SIZE);
+    if (err != ERR_SUCCESS)
+        return err;
+
+    _group_from_record(zar_file, record, count, group);
+    return ERR_SUCCESS;
+}
+
+#ifndef ZAR_NO_NAMES
+zos_err_t zar_group_from_name(zar_file_t* zar_file, const char* name, zar_group_t* group)
+{
+    zos_err_t err;
+    uint8_t i, count;
+    char record[ZAR_GROUP_SIZE + 1];
+
+    err = _seek_to_groups(zar_file, &count);
+    if (err != ERR_SUCCESS)
+        return err;
+
+    // the records are contiguous, read them one after the other
+    for (i = 0; i < count; i++) {
+        err = _read_exact(zar_file->fd, record, ZAR_GROUP_SIZE);
+        if (err != ERR_SUCCESS)
+            return err;
+
+        // names shorter than ZAR_MAX_GROUPNAME are null padded
+        char c = record[ZAR_MAX_GROUPNAME];
+        record[ZAR_MAX_GROUPNAME] = '\0';
+        if (str_cmp(record, name) == 0) {
+            record[ZAR_MAX_GROUPNAME] = c;
+            _group_from_record(zar_file, (uint8_t*) record, count, group);
+            return ERR_SUCCESS;
+        }
+    }
+    return ERR_NO_SUCH_ENTRY;
+}
+#endif // ZAR_NO_NAMES
+
+zos_err_t zar_group_read(zar_file_t* zar_file, zar_group_t* group, uint8_t* buffer, uint16_t size, zar_group_member_t* members)
+{
+    zos_err_t err;
+    uint8_t i;
+    uint8_t* data    = buffer;
+    uint16_t records = (uint16_t) group->count * ZAR_GROUP_MEMBER_SIZE;
+
+    if ((size < group->size) || (size < records))
+        return ERR_NO_MORE_MEMORY;
+
+    // member records first, read at once into the tail of the buffer, they
+    // tell where each entry lands and are parsed before the data overwrites them
+    uint8_t* record = buffer + size - records;
+    uint32_t offset = group->members;
+    err             = seek(zar_file->fd, &offset, SEEK_SET);
+    if (err != ERR_SUCCESS)
+        return err;
+
+    err = _read_exact(zar_file->fd, record, records);
+    if (err != ERR_SUCCESS)
+        return err;
+
+    for (i = 0; i < group->count; i++) {
+        members[i].index = record[0];
+        members[i].size  = record[1] | (record[2] << 8);
+        members[i].data  = data;
+        data            += members[i].size;
+        record          += ZAR_GROUP_MEMBER_SIZE;
+    }
+
+#ifndef ZAR_NO_BOUNDS_CHECK
+    if ((uint16_t) (data - buffer) != group->size)
+        return ERR_ENTRY_CORRUPTED;
+#endif
+
+    // then the whole group in one read
+    offset = group->position;
+    err    = seek(zar_file->fd, &offset, SEEK_SET);
+    if (err != ERR_SUCCESS)
+        return err;
+
+    return _read_exact(zar_file->fd, buffer, group->size);
+}
+#endif // ZAR_NO_GROUPS
+
+#ifndef ZAR_NO_CHECKSUMS
+uint16_t zar_checksum(uint16_t checksum, const uint8_t* data, uint16_t size)
+{
+    // CRC-16 CCITT (0x1021), a byte at a time without a table
+    uint8_t x;
+
+    while (size--) {
+        x        = (checksum >> 8) ^ *data++;
+        x       ^= x >> 4;
+        checksum = (checksum << 8) ^ ((uint16_t) x << 12) ^ ((uint16_t) x << 5) ^ x;
+    }
+    return checksum;
+}
+
+zos_err_t zar_file_entry_checksum(zar_file_t* zar_file, uint8_t index, uint16_t* checksum)
+{
+    zos_err_t err;
+
+    if ((zar_file->flags & ZAR_FLAG_CHECKSUMS) == 0)
+        return ERR_NO_SUCH_ENTRY;
+
+#ifndef ZAR_NO_BOUNDS_CHECK
+    if (index >= zar_file->file_count)
+        return ERR_INVALID_OFFSET;
+#endif
+
+    uint32_t offset = _table_offset(zar_file, ZAR_FLAG_CHECKSUMS) + (ZAR_CHECKSUM_SIZE * index);
+    err             = seek(zar_file->fd, &offset, SEEK_SET);
+    if (err != ERR_SUCCESS)
+        return err;
+
+    // little endian, like every other field
+    return _read_exact(zar_file->fd, checksum, ZAR_CHECKSUM_SIZE);
+}
+#endif // ZAR_NO_CHECKSUMS
+
+#ifndef ZAR_NO_STREAM
+zos_err_t zar_stream_open(const char* path, zar_file_t* zar_file)
+{
+    zos_err_t err = zar_file_open(path, zar_file);
+    if (err != ERR_SUCCESS)
+        return err;
+
+    zar_file->offset = (zar_file->version == 0) ? ZAR_FILE_HEADER_SIZE : ZAR_FILE_HEADER_SIZE_V1;
+    return ERR_SUCCESS;
+}
+
+zos_err_t zar_stream_entry(zar_file_t* zar_file, zar_file_entry_t* entry, zar_filename filename)
+{
+    zos_err_t err;
+    uint8_t record[ZAR_ENTRY_SIZE_V1];
+    uint8_t* name       = &record[sizeof(uint32_t)];
+    uint16_t entry_size = ZAR_ENTRY_SIZE;
+
+    if (zar_file->version >= 1) {
+        entry_size = ZAR_ENTRY_SIZE_V1;
+        name++;
+    }
+
+    err = _read_exact(zar_file->fd, record, entry_size);
+    if (err != ERR_SUCCESS)
+        return err;
+    zar_file->offset += entry_size;
+
+    // position + size
+    mem_cpy(entry, record, sizeof(uint32_t));
+    entry->cursor = 0;
+    entry->flags  = (zar_file->version >= 1) ? record[sizeof(uint32_t)] : 0;
+
+#ifndef ZAR_NO_NAMES
+    _short_name((const char*) name, (const char*) &name[ZAR_MAX_BASENAME], filename);
+#else
+    (void) filename;
+#endif
+    return ERR_SUCCESS;
+}
+
+zos_err_t zar_stream_read(zar_file_t* zar_file, zar_file_entry_t* entry, uint8_t* buffer, uint16_t* size)
+{
+    zos_err_t err;
+    uint16_t target = entry->position + entry->cursor;
+    uint16_t chunk;
+
+    if (*size == 0)
+        return ERR_INVALID_PARAMETER;
+
+    // the stream only moves forward
+    if (zar_file->offset > target)
+        return ERR_INVALID_OFFSET;
+
+    // skip the gap by reading it into the caller's buffer
+    while (zar_file->offset < target) {
+        chunk = target - zar_file->offset;
+        if (chunk > *size)
+            chunk = *size;
+        err = _read_exact(zar_file->fd, buffer, chunk);
+        if (err != ERR_SUCCESS)
+            return err;
+        zar_file->offset += chunk;
+    }
+
+    if (entry->cursor >= entry->size) {
+        *size = 0;
+        return ERR_NO_MORE_ENTRIES; // EOF
+    }
+
+    // don't read past the file length
+    chunk = entry->size - entry->cursor;
+    if (*size > chunk) {
+        *size = chunk;
+    }
+
+    err = _read_exact(zar_file->fd, buffer, *size);
+    if (err != ERR_SUCCESS)
+        return err;
 
+    zar_file->offset += *size;
+    entry->cursor    += *size;
     return ERR_SUCCESS;
 }
+#endif // ZAR_NO_STREAM
 
+#ifndef ZAR_NO_NAMES
 zos_err_t zar_file_entry_from_name(zar_file_t* zar_file, const char* name, zar_file_entry_t* entry)
 {
     uint8_t index = zar_file_entry_index_of_name(zar_file, name);
@@ -208,10 +716,12 @@ zos_err_t zar_file_entry_from_name(zar_file_t* zar_file, const char* name, zar_f
 
 zos_err_t zar_file_entry_name_of_index(zar_file_t* zar_file, uint8_t index, zar_filename filename)
 {
+#ifndef ZAR_NO_BOUNDS_CHECK
     if (index == ZAR_INVALID_NAME)
         return ERR_INVALID_PATH;
     if (index >= zar_file->file_count)
         return ERR_INVALID_OFFSET;
+#endif
 
     uint16_t size;
     zos_err_t err;
@@ -220,9 +730,8 @@ zos_err_t zar_file_entry_name_of_index(zar_file_t* zar_file, uint8_t index, zar_
     if (err != ERR_SUCCESS)
         return err;
 
-    // skip over the position/size
-    uint32_t offset = sizeof(uint32_t);
-    uint32_t pos    = offset;
+    // skip over the position/size/flags
+    uint32_t offset = (zar_file->version == 0) ? sizeof(uint32_t) : sizeof(uint32_t) + 1;
     err             = seek(zar_file->fd, &offset, SEEK_CUR);
     if (err != ERR_SUCCESS)
         return err;
@@ -245,15 +754,36 @@ zos_err_t zar_file_entry_name_of_index(zar_file_t* zar_file, uint8_t index, zar_
 
 uint8_t zar_file_entry_index_of_name(zar_file_t* zar_file, const char* name)
 {
-    uint8_t i;
-    zar_filename filename;
-
-    for (i = 0; i < zar_file->file_count; i++) {
-        zar_file_entry_name_of_index(zar_file, i, filename);
-
-        if (str_cmp(filename, name) == 0) {
-            return i;
+    uint8_t index = ZAR_INVALID_NAME;
+    uint8_t len;
+    zar_file_entry_t dir;
+    zar_filename part;
+
+    zar_file_root(zar_file, &dir);
+    while (*name) {
+        // split off the next path component
+        len = 0;
+        while (*name && *name != '/') {
+            if (len > ZAR_MAX_FILENAME)
+                return ZAR_INVALID_NAME;
+            part[len++] = *name++;
         }
+        part[len] = '\0';
+        if (*name == '/')
+            name++;
+        if (len == 0)
+            continue;
+
+        // only directories have children
+        if ((dir.flags & ZAR_ENTRY_DIR) == 0)
+            return ZAR_INVALID_NAME;
+
+        index = _index_of_name_in(zar_file, &dir, part);
+        if (index == ZAR_INVALID_NAME)
+            return index;
+        if (zar_file_entry_from_index(zar_file, index, &dir) != ERR_SUCCESS)
+            return ZAR_INVALID_NAME;
     }
-    return ZAR_INVALID_NAME;
+    return index;
 }
+#endif // ZAR_NO_NAMES
@@ -17,16 +17,56 @@
 #define F_LIST    0x02
 #define F_VERBOSE 0x04
 #define F_FORCE   0x08
+#define F_STREAM  0x10
+#define F_UPDATE  0x20
+
+// longest input/output path accepted on the command line
+#ifndef ZAR_PATH_MAX
+#define ZAR_PATH_MAX PATH_MAX
+#endif
 
 typedef struct {
         uint8_t flags;
-        char input[PATH_MAX];
-        char output[PATH_MAX];
+        char input[ZAR_PATH_MAX];
+        char output[ZAR_PATH_MAX];
 } options_t;
 
 options_t options;
 char CWD[PATH_MAX];
-uint8_t buffer[1024];
+uint8_t buffer[ZAR_BUFFER_SIZE];
+
+// path of the current entry, relative to the archive root
+char path[ZAR_PATH_MAX];
+uint8_t path_len;
+// length of options.output, output + path must fit in ZAR_PATH_MAX
+uint8_t output_len;
+
+typedef zos_err_t (*visit_t)(zar_file_t* zar_file, uint8_t index, zar_file_entry_t* entry);
+typedef zos_err_t (*read_t)(zar_file_t* zar_file, zar_file_entry_t* entry, uint8_t* buffer, uint16_t* size);
+
+// zar_stream_read when the input is streamed
+read_t read_entry = zar_file_read;
+
+// update mode totals, in files and bytes
+uint8_t written_count;
+uint8_t skipped_count;
+uint16_t written_bytes;
+uint16_t skipped_bytes;
+
+#ifndef ZAR_NO_STREAM
+// the whole directory of a streamed archive, ~5KB of RAM, see ZAR_NO_STREAM
+typedef struct {
+        uint16_t position;
+        uint16_t size;
+        uint8_t flags;
+        uint8_t parent;
+        zar_filename name;
+} stream_entry_t;
+
+stream_entry_t stream_entries[ZAR_MAX_ENTRIES];
+// file indexes, in position order
+uint8_t stream_order[ZAR_MAX_ENTRIES];
+#endif
 
 void set_color(uint8_t fg)
 {
@@ -41,11 +81,15 @@ void print_usage(zos_err_t err)
         set_color(TEXT_COLOR_WHITE);
     }
 
-    printf("\nUsage: zar [xlvf] input_file.zar output/path\n");
+    printf("\nUsage: zar [xlvfsu] input_file.zar output/path\n");
     printf("  -x    extract\n");
     printf("  -l    list files\n");
     printf("  -v    verbose\n");
     printf("  -f    force, overwrite existing files\n");
+    printf("  -u    update, extract only the files that changed\n");
+#ifndef ZAR_NO_STREAM
+    printf("  -s    stream, read the input once without seeking (ie: #SER0)\n");
+#endif
     printf("  -h    this help message\n");
     printf("\n\nExample:\n");
     printf("\n  zar xl input.zar B:/output/path/\n\n");
@@ -59,8 +103,8 @@ void parse_arguments(int argc, char** argv)
 {
     // clear options
     options.flags = F_NONE;
-    mem_set(&options.input, 0, PATH_MAX);
-    mem_set(&options.output, 0, PATH_MAX);
+    mem_set(&options.input, 0, ZAR_PATH_MAX);
+    mem_set(&options.output, 0, ZAR_PATH_MAX);
 
     uint8_t i, l, index = 0;
     if (argc == 1) {
@@ -87,6 +131,10 @@ void parse_arguments(int argc, char** argv)
                     case 'l': options.flags |= F_LIST; break;
                     case 'v': options.flags |= F_VERBOSE; break;
                     case 'f': options.flags |= F_FORCE; break;
+                    case 'u': options.flags |= F_UPDATE | F_EXTRACT; break;
+#ifndef ZAR_NO_STREAM
+                    case 's': options.flags |= F_STREAM; break;
+#endif
                     case 'h': print_usage(ERR_SUCCESS); exit(ERR_SUCCESS);
                     default: print_usage(ERR_INVALID_PARAMETER);
                 }
@@ -96,52 +144,333 @@ void parse_arguments(int argc, char** argv)
 
         if (tokens >= (1 + index)) {
             l = str_len(args[0 + index]);
+            if (l >= ZAR_PATH_MAX)
+                print_usage(ERR_PATH_TOO_LONG);
             mem_cpy(options.input, args[0 + index], l);
         }
 
 
         if (tokens >= (2 + index)) {
             l = str_len(args[1 + index]);
+            if (l >= (ZAR_PATH_MAX - 1))
+                print_usage(ERR_PATH_TOO_LONG);
             mem_cpy(options.output, args[1 + index], l);
             if (options.output[l - 1] != '/') {
                 options.output[l] = '/';
             }
+            output_len = str_len(options.output);
         }
     } else {
         print_usage(ERR_INVALID_PARAMETER);
     }
 }
 
-zos_err_t list_files(zar_file_t* zar_file)
+zos_err_t entry_name(zar_file_t* zar_file, uint8_t index, zar_filename filename)
 {
-    zos_err_t err = ERR_SUCCESS;
+#ifdef ZAR_NO_NAMES
+    // no names in this build, entries are known by their index, ie: 007.bin
+    (void) zar_file;
+    filename[0] = '0' + (index / 100);
+    filename[1] = '0' + ((index / 10) % 10);
+    filename[2] = '0' + (index % 10);
+    mem_cpy(&filename[3], ".bin", 5);
+    return ERR_SUCCESS;
+#else
+    return zar_file_entry_name_of_index(zar_file, index, filename);
+#endif
+}
 
-    set_color(TEXT_COLOR_WHITE);
-    printf("Filename        Size   Pos\n");
-    printf("------------  ------ -----\n");
+// entry names are joined into paths, each must be a single component
+uint8_t valid_name(const char* name)
+{
+    const char* c;
+
+    if ((name[0] == '\0') || (str_cmp(name, ".") == 0) || (str_cmp(name, "..") == 0))
+        return 0;
 
-    uint8_t i;
+    // no separators, and no drive letter, ie: "A:"
+    for (c = name; *c; c++) {
+        if ((*c == '/') || (*c == '\\') || (*c == ':'))
+            return 0;
+    }
+    return 1;
+}
+
+zos_err_t walk_dir(zar_file_t* zar_file, zar_file_entry_t* dir, visit_t visit)
+{
+    zos_err_t err;
+    uint8_t i, l;
+    uint8_t len   = path_len;
+    uint16_t last = dir->position + dir->size;
     zar_file_entry_t entry;
     zar_filename filename;
-    for (i = 0; i < zar_file->file_count; i++) {
+
+    for (i = (uint8_t) dir->position; i < last; i++) {
         err = zar_file_entry_from_index(zar_file, i, &entry);
         if (err != ERR_SUCCESS) {
             printf("\nFailed to get entry at index %d, %d [%02x]\n", i, err, err);
             return err;
         }
-        err = zar_file_entry_name_of_index(zar_file, i, filename);
-        if(err != ERR_SUCCESS) {
+
+        err = entry_name(zar_file, i, filename);
+        if (err != ERR_SUCCESS) {
             printf("\nFailed to get entry name at index %d, %d [%02x]\n", i, err, err);
-            exit(err);
+            return err;
+        }
+
+        if (!valid_name(filename)) {
+            printf("\nInvalid name at index %d\n", i);
+            return ERR_ENTRY_CORRUPTED;
+        }
+
+        // children are always stored after their directory
+        if ((entry.flags & ZAR_ENTRY_DIR) && (entry.position <= i)) {
+            printf("\nInvalid directory at index %d\n", i);
+            return ERR_ENTRY_CORRUPTED;
+        }
+
+        l = str_len(filename);
+        if ((output_len + len + l + 1) >= ZAR_PATH_MAX) {
+            printf("\nPath too long: %s%s\n", path, filename);
+            return ERR_PATH_TOO_LONG;
         }
+        mem_cpy(&path[len], filename, l + 1);
+        path_len = len + l;
 
-        printf("%-12s  %5dB %5d\n", filename, entry.size, entry.position);
+        err = visit(zar_file, i, &entry);
+        if (err != ERR_SUCCESS)
+            return err;
+
+        if (entry.flags & ZAR_ENTRY_DIR) {
+            path[path_len++] = '/';
+            path[path_len]   = '\0';
+            err              = walk_dir(zar_file, &entry, visit);
+            if (err != ERR_SUCCESS)
+                return err;
+        }
+
+        path_len  = len;
+        path[len] = '\0';
     }
 
+    return ERR_SUCCESS;
+}
+
+zos_err_t list_entry(zar_file_t* zar_file, uint8_t index, zar_file_entry_t* entry)
+{
+    (void) zar_file;
+    (void) index;
+
+    if (entry->flags & ZAR_ENTRY_DIR) {
+        printf("%-12s   <DIR>\n", path);
+    } else {
+        printf("%-12s  %5uB %5u\n", path, entry->size, entry->position);
+    }
+    return ERR_SUCCESS;
+}
+
+zos_err_t list_files(zar_file_t* zar_file)
+{
+    zar_file_entry_t root;
+
+    set_color(TEXT_COLOR_WHITE);
+    printf("Filename        Size   Pos\n");
+    printf("------------  ------ -----\n");
+
+    path_len = 0;
+    path[0]  = '\0';
+    zar_file_root(zar_file, &root);
+    return walk_dir(zar_file, &root, list_entry);
+}
+
+// reads up to `size` bytes of the destination file, fewer only at its end
+uint16_t read_output(zos_dev_t fd, uint8_t* data, uint16_t size)
+{
+    uint16_t total = 0;
+    uint16_t chunk;
+
+    while (total < size) {
+        chunk = size - total;
+        if ((read(fd, &data[total], &chunk) != ERR_SUCCESS) || (chunk == 0))
+            break;
+        total += chunk;
+    }
+    return total;
+}
+
+uint8_t same_bytes(const uint8_t* a, const uint8_t* b, uint16_t size)
+{
+    while (size--) {
+        if (*a++ != *b++)
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * Compares the destination of an entry with the archive, before writing it.
+ *
+ * `same` is set when the destination already holds the entry. Otherwise
+ * `offset` is the number of leading bytes found identical and the next
+ * `pending` bytes of the entry, already read, are at the start of `buffer`.
+ * With a checksum table only the destination is read, else both are read one
+ * half buffer at a time, which works on a stream too. Errors are archive
+ * read errors, a missing or unreadable destination only differs.
+ */
+zos_err_t compare_entry(zar_file_t* zar_file, uint8_t index, zar_file_entry_t* entry, uint8_t* same, uint16_t* offset, uint16_t* pending)
+{
+    zos_err_t err;
+    zos_stat_t st;
+    uint16_t size;
+    const uint16_t half = sizeof(buffer) / 2;
+
+    *same    = 0;
+    *offset  = 0;
+    *pending = 0;
+
+    // a different size is always rewritten, and truncated
+    if ((stat(path, &st) != ERR_SUCCESS) || (st.s_size != entry->size))
+        return ERR_SUCCESS;
+
+    zos_dev_t fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return ERR_SUCCESS;
+
+#ifndef ZAR_NO_CHECKSUMS
+    uint16_t expected;
+    err = ERR_NO_SUCH_ENTRY;
+    if (!(options.flags & F_STREAM)) {
+        err = zar_file_entry_checksum(zar_file, index, &expected);
+    }
+    if (err == ERR_SUCCESS) {
+        uint16_t checksum = ZAR_CHECKSUM_INIT;
+        while ((size = read_output(fd, buffer, sizeof(buffer))) > 0) {
+            checksum = zar_checksum(checksum, buffer, size);
+        }
+        close(fd);
+        *same = (checksum == expected);
+        return ERR_SUCCESS;
+    }
+    if (err != ERR_NO_SUCH_ENTRY) {
+        close(fd);
+        return err;
+    }
+#else
+    (void) index;
+#endif
+
+    do {
+        size = half;
+        err  = read_entry(zar_file, entry, buffer, &size);
+        if (err == ERR_NO_MORE_ENTRIES) {
+            *same = 1;
+            err   = ERR_SUCCESS;
+            break;
+        }
+        if (err != ERR_SUCCESS)
+            break;
+
+        if ((read_output(fd, &buffer[half], size) != size) || !same_bytes(buffer, &buffer[half], size)) {
+            *pending = size;
+            break;
+        }
+        *offset += size;
+    } while (1);
+
+    close(fd);
     return err;
 }
 
-zos_err_t extract_files(zar_file_t* zar_file)
+zos_err_t extract_entry(zar_file_t* zar_file, uint8_t index, zar_file_entry_t* entry)
+{
+    zos_err_t err;
+    uint16_t offset  = 0;
+    uint16_t pending = 0;
+    uint8_t same     = 0;
+    uint8_t mode     = O_WRONLY | O_CREAT | O_TRUNC;
+
+    if (entry->flags & ZAR_ENTRY_DIR) {
+        if (options.flags & F_VERBOSE) {
+            printf("creating: %s%s\n", options.output, path);
+        }
+        err = mkdir(path);
+        if ((err != ERR_SUCCESS) && (err != ERR_ALREADY_EXIST)) {
+            printf("Failed to create %s%s, %d [%02x]\n", options.output, path, err, err);
+            return err;
+        }
+        return ERR_SUCCESS;
+    }
+
+    if (options.flags & F_UPDATE) {
+        err = compare_entry(zar_file, index, entry, &same, &offset, &pending);
+        if (err != ERR_SUCCESS) {
+            printf("Failed to read %s for %s, %d [%02x]\n", options.input, path, err, err);
+            return err;
+        }
+        if (same) {
+            if (options.flags & F_VERBOSE) {
+                printf("unchanged: %s%s\n", options.output, path);
+            }
+            skipped_count++;
+            skipped_bytes += entry->size;
+            return ERR_SUCCESS;
+        }
+        // the identical leading bytes are kept, only the rest is written
+        if ((offset > 0) || (pending > 0)) {
+            mode = O_WRONLY;
+        }
+    }
+
+    // open output file for writing
+    zos_dev_t fd = open(path, mode);
+    if (fd < 0) {
+        printf("Failed to open %s%s, %d [%02x]\n", options.output, path, -fd, -fd);
+        return ERR_SUCCESS; // try the next file?
+    }
+    if (options.flags & F_VERBOSE) {
+        printf("extracting: %s%s\n", options.output, path);
+    }
+    if (offset > 0) {
+        int32_t seek_to = offset;
+        err             = seek(fd, &seek_to, SEEK_SET);
+        if (err != ERR_SUCCESS) {
+            printf("Failed to seek in %s%s, %d [%02x]\n", options.output, path, err, err);
+            close(fd);
+            return err;
+        }
+    }
+    written_count++;
+
+    // read ZAR_BUFFER_SIZE at a time, the compared chunk goes first
+    uint16_t size = sizeof(buffer);
+    do {
+        if (pending > 0) {
+            size    = pending;
+            pending = 0;
+            err     = ERR_SUCCESS;
+        } else {
+            size = sizeof(buffer);
+            err  = read_entry(zar_file, entry, buffer, &size);
+        }
+        if (size > 0) {
+            if (err != ERR_SUCCESS) {
+                printf("Failed to read %d bytes from %s for %s\n", size, options.input, path);
+                close(fd);
+                return err;
+            }
+            err = write(fd, &buffer, &size);
+            if (err != ERR_SUCCESS) {
+                printf("Failed to write %d bytes to %s%s\n", size, options.output, path);
+                close(fd);
+                return err;
+            }
+            written_bytes += size;
+        }
+    } while (size > 0);
+    return close(fd);
+}
+
+void open_output(void)
 {
     zos_err_t err;
     // dirty trick for determining if the dir exists or not
@@ -151,8 +480,8 @@ zos_err_t extract_files(zar_file_t* zar_file)
         close(output_dir);
 
     // if it exists, or the force flag is not present, error ...
-    if ((output_dir >= 0) && !(options.flags & F_FORCE)) {
-        printf("\nOutput exists, use `f` flag to force: %s\n", options.output);
+    if ((output_dir >= 0) && !(options.flags & (F_FORCE | F_UPDATE))) {
+        printf("\nOutput exists, use `f` flag to force or `u` to update: %s\n", options.output);
         exit(ERR_ALREADY_EXIST);
     }
 
@@ -176,57 +505,170 @@ zos_err_t extract_files(zar_file_t* zar_file)
     curdir(CWD);
     chdir(options.output);
 
-    uint8_t i;
+    written_count = 0;
+    skipped_count = 0;
+    written_bytes = 0;
+    skipped_bytes = 0;
+}
+
+void print_summary(void)
+{
+    if (!(options.flags & F_UPDATE))
+        return;
+
+    set_color(TEXT_COLOR_WHITE);
+    printf("\n%d written, %uB\n", written_count, written_bytes);
+    printf("%d unchanged, %uB\n", skipped_count, skipped_bytes);
+}
+
+zos_err_t extract_files(zar_file_t* zar_file)
+{
+    zos_err_t err;
+    zar_file_entry_t root;
+
+    open_output();
+
+    path_len = 0;
+    path[0]  = '\0';
+    zar_file_root(zar_file, &root);
+    err = walk_dir(zar_file, &root, extract_entry);
+    if (err != ERR_SUCCESS)
+        return err;
+
+    print_summary();
+    return chdir(CWD);
+}
+
+#ifndef ZAR_NO_STREAM
+// builds the path of a streamed entry from its parents, ZAR_INVALID_NAME if too long
+uint8_t stream_path(uint8_t index)
+{
+    uint8_t l, len        = 0;
+    stream_entry_t* entry = &stream_entries[index];
+
+    if (entry->parent != ZAR_INVALID_NAME) {
+        len = stream_path(entry->parent);
+        if (len == ZAR_INVALID_NAME)
+            return len;
+        path[len++] = '/';
+    }
+
+    l = str_len(entry->name);
+    if ((output_len + len + l) >= ZAR_PATH_MAX)
+        return ZAR_INVALID_NAME;
+    mem_cpy(&path[len], entry->name, l + 1);
+    return len + l;
+}
+
+zos_err_t stream_visit(zar_file_t* zar_file, uint8_t index, visit_t visit)
+{
     zar_file_entry_t entry;
-    zar_filename filename;
+    stream_entry_t* current = &stream_entries[index];
+
+    path_len = stream_path(index);
+    if (path_len == ZAR_INVALID_NAME) {
+        printf("\nPath too long at index %d\n", index);
+        return ERR_PATH_TOO_LONG;
+    }
+
+    entry.position = current->position;
+    entry.size     = current->size;
+    entry.cursor   = 0;
+    entry.flags    = current->flags;
+    return visit(zar_file, index, &entry);
+}
+
+zos_err_t stream_files(zar_file_t* zar_file)
+{
+    zos_err_t err;
+    uint8_t i, j;
+    uint8_t count = 0;
+    uint16_t last;
+    zar_file_entry_t entry;
+    stream_entry_t* current;
+
     for (i = 0; i < zar_file->file_count; i++) {
-        err = zar_file_entry_from_index(zar_file, i, &entry);
+        stream_entries[i].parent = ZAR_INVALID_NAME;
+    }
+
+    // the directory comes first, read it once
+    for (i = 0; i < zar_file->file_count; i++) {
+        current = &stream_entries[i];
+        err     = zar_stream_entry(zar_file, &entry, current->name);
         if (err != ERR_SUCCESS) {
             printf("\nFailed to get entry at index %d, %d [%02x]\n", i, err, err);
-            exit(err);
+            return err;
+        }
+#ifdef ZAR_NO_NAMES
+        entry_name(zar_file, i, current->name);
+#endif
+        if (!valid_name(current->name)) {
+            printf("\nInvalid name at index %d\n", i);
+            return ERR_ENTRY_CORRUPTED;
         }
 
-        err = zar_file_entry_name_of_index(zar_file, i, filename);
-        if(err != ERR_SUCCESS) {
-            printf("\nFailed to get entry name at index %d, %d [%02x]\n", i, err, err);
-            exit(err);
+        current->position = entry.position;
+        current->size     = entry.size;
+        current->flags    = entry.flags;
+
+        if (entry.flags & ZAR_ENTRY_DIR) {
+            // children are always stored after their directory
+            last = entry.position + entry.size;
+            if ((entry.position <= i) || (last > zar_file->file_count)) {
+                printf("\nInvalid directory at index %d\n", i);
+                return ERR_ENTRY_CORRUPTED;
+            }
+            for (j = (uint8_t) entry.position; j < last; j++) {
+                stream_entries[j].parent = i;
+            }
+        } else {
+            // insertion sort, archives are usually already in position order
+            j = count++;
+            while ((j > 0) && (stream_entries[stream_order[j - 1]].position > entry.position)) {
+                stream_order[j] = stream_order[j - 1];
+                j--;
+            }
+            stream_order[j] = i;
         }
+    }
 
-        // open output file for writing
-        zos_dev_t fd = open(filename, O_WRONLY | O_CREAT);
-        if (fd < 0) {
-            printf("Failed to open %s%s, %d [%02x]\n", options.output, filename, -fd, -fd);
-            continue; // try the next file?
+    if (options.flags & F_LIST) {
+        set_color(TEXT_COLOR_WHITE);
+        printf("Filename        Size   Pos\n");
+        printf("------------  ------ -----\n");
+        for (i = 0; i < zar_file->file_count; i++) {
+            err = stream_visit(zar_file, i, list_entry);
+            if (err != ERR_SUCCESS)
+                return err;
         }
-        if (options.flags & F_VERBOSE) {
-            printf("extracting: %s%s\n", options.output, filename);
-        }
-
-        // read 1k at a time
-        uint16_t size = sizeof(buffer);
-        do {
-            err = zar_file_read(zar_file, &entry, buffer, &size);
-            if (size > 0) {
-                if (err != ERR_SUCCESS) {
-                    printf("Failed to read %d bytes from %s for %s\n", size, options.input, filename);
-                    err = close(fd);
-                    goto extract_files_done;
-                }
-                err = write(fd, &buffer, &size);
-                if (err != ERR_SUCCESS) {
-                    printf("Failed to write %d bytes to %s%s\n", size, options.output, filename);
-                    err = close(fd);
-                    goto extract_files_done;
-                }
-            }
-        } while (size > 0);
-        err = close(fd);
-        if(err != ERR_SUCCESS) return err;
     }
-    err = chdir(CWD);
-extract_files_done:
-    return err;
+
+    if (!(options.flags & F_EXTRACT))
+        return ERR_SUCCESS;
+
+    open_output();
+    read_entry = zar_stream_read;
+
+    // parents come before their children, create the directories first
+    for (i = 0; i < zar_file->file_count; i++) {
+        if (stream_entries[i].flags & ZAR_ENTRY_DIR) {
+            err = stream_visit(zar_file, i, extract_entry);
+            if (err != ERR_SUCCESS)
+                return err;
+        }
+    }
+
+    // then the files, strictly forward through the data
+    for (i = 0; i < count; i++) {
+        err = stream_visit(zar_file, stream_order[i], extract_entry);
+        if (err != ERR_SUCCESS)
+            return err;
+    }
+
+    print_summary();
+    return chdir(CWD);
 }
+#endif // ZAR_NO_STREAM
 
 int main(int argc, char** argv)
 {
@@ -246,6 +688,8 @@ int main(int argc, char** argv)
         printf("      list: %s\n", options.flags & F_LIST ? "True" : "False");
         printf("   verbose: %s\n", options.flags & F_VERBOSE ? "True" : "False");
         printf("     force: %s\n", options.flags & F_FORCE ? "True" : "False");
+        printf("    update: %s\n", options.flags & F_UPDATE ? "True" : "False");
+        printf("    stream: %s\n", options.flags & F_STREAM ? "True" : "False");
         if (options.input[0] != 0x00) {
             printf("     input: ");
             set_color(TEXT_COLOR_YELLOW);
@@ -269,7 +713,14 @@ int main(int argc, char** argv)
     }
 
     zar_file_t zar_file;
-    err = zar_file_open(options.input, &zar_file);
+#ifndef ZAR_NO_STREAM
+    if (options.flags & F_STREAM) {
+        err = zar_stream_open(options.input, &zar_file);
+    } else
+#endif
+    {
+        err = zar_file_open(options.input, &zar_file);
+    }
     if (err != ERR_SUCCESS) {
         printf("\nFailed to open %s archive, %d [%02x]\n", options.input, err, err);
         exit(err);
@@ -280,19 +731,32 @@ int main(int argc, char** argv)
         printf("Header:\n");
         set_color(TEXT_COLOR_LIGHT_GRAY);
         printf("   Version: %d\n", zar_file.version);
-        printf("File Count: %d\n\n", zar_file.file_count);
+        printf("File Count: %d\n", zar_file.file_count);
+        printf("Root Count: %d\n\n", zar_file.root_count);
         set_color(TEXT_COLOR_WHITE);
     }
 
+    if ((options.flags & F_EXTRACT) && (options.flags & F_VERBOSE)) {
+        printf("Extracting %s to %s\n", options.input, options.output);
+    }
+
+#ifndef ZAR_NO_STREAM
+    if (options.flags & F_STREAM) {
+        // a truncated transfer must not exit cleanly
+        err = stream_files(&zar_file);
+        if (err != ERR_SUCCESS) {
+            zar_file_close(&zar_file);
+            return err;
+        }
+        return zar_file_close(&zar_file);
+    }
+#endif
+
     if (options.flags & F_LIST) {
         list_files(&zar_file);
     }
 
     if (options.flags & F_EXTRACT) {
-        if (options.flags & F_VERBOSE) {
-            printf("Extracting %s to %s\n", options.input, options.output);
-        }
-
         extract_files(&zar_file);
     }
 
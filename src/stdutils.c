@@ -2,6 +2,19 @@
 #include <core.h>
 #include "stdutils.h"
 
+// size of the stack buffer a single printf() call is formatted into
+#ifndef ZAR_PRINTF_BUFFER
+#define ZAR_PRINTF_BUFFER 256
+#endif
+
+// appends a character to the formatted output, anything past the buffer is dropped
+#define PUT_CHAR(c)                              \
+    do {                                         \
+        char ch = (c);                           \
+        if (i < (ZAR_PRINTF_BUFFER - 1))         \
+            buffer[i++] = ch;                    \
+    } while (0)
+
 char* strtok(char* str, const char* delim)
 {
     static char* next_token = NULL; // Stores the next position to continue tokenizing
@@ -36,9 +49,10 @@ char* strtok(char* str, const char* delim)
     return token_start;
 }
 
-static void format_itoa(int num, char* str, uint8_t base, char alpha) {
+static void format_itoa(int num, char* str, uint8_t base, char alpha, uint8_t is_signed) {
     int i = 0;
     int is_negative = 0;
+    unsigned int value = (unsigned int) num;
 
     // Handle 0 explicitly, otherwise empty string is printed
     if (num == 0) {
@@ -47,17 +61,17 @@ static void format_itoa(int num, char* str, uint8_t base, char alpha) {
         return;
     }
 
-    // Handle negative numbers only if base is 10
-    if (num < 0 && base == 10) {
+    // Handle negative numbers only for signed conversions
+    if (is_signed && num < 0) {
         is_negative = 1;
-        num = -num;
+        value = 0 - value;
     }
 
     // Process individual digits
-    while (num != 0) {
-        int rem = num % base;
+    while (value != 0) {
+        uint8_t rem = value % base;
         str[i++] = (rem > 9) ? (rem - 10) + alpha : rem + '0';
-        num = num / base;
+        value = value / base;
     }
 
     // Append negative sign for negative numbers
@@ -75,9 +89,52 @@ static void format_itoa(int num, char* str, uint8_t base, char alpha) {
     }
 }
 
+#ifdef ZAR_TINY_PRINTF
+// Minimal printf(), widths and alignment are parsed but ignored
+void __fprintf(zos_dev_t dev, const char* format, va_list args) {
+    char buffer[ZAR_PRINTF_BUFFER];
+    char num_str[8];
+    const char* str;
+    uint8_t base;
+    int i = 0;
+
+    while (*format) {
+        if (*format == '%' && *(format + 1)) {
+            format++;
+            // skip alignment and width
+            while (*format == '-' || (*format >= '0' && *format <= '9')) {
+                format++;
+            }
+
+            base = 10;
+            str  = NULL;
+            switch (*format) {
+                case 's': str = va_arg(args, const char*); break;
+                case 'X':
+                case 'x': base = 16; // fallthru
+                case 'u':
+                case 'd':
+                    format_itoa(va_arg(args, int), num_str, base, *format == 'X' ? 'A' : 'a', *format == 'd');
+                    str = num_str;
+                    break;
+                default: break;
+            }
+            while (str && *str) {
+                PUT_CHAR(*str++);
+            }
+        } else {
+            PUT_CHAR(*format);
+        }
+        format++;
+    }
+
+    uint16_t size = i;
+    write(dev, buffer, &size);
+}
+#else
 // Simplified version of printf() with width and alignment support
 void __fprintf(zos_dev_t dev, const char* format, va_list args) {
-    char buffer[256];  // Output buffer for formatting
+    char buffer[ZAR_PRINTF_BUFFER];  // Output buffer for formatting
     int i = 0;
 
     while (*format) {
@@ -113,32 +170,33 @@ void __fprintf(zos_dev_t dev, const char* format, va_list args) {
                     if (left_align) {
                         // Copy the string
                         while (*str) {
-                            buffer[i++] = *str++;
+                            PUT_CHAR(*str++);
                         }
 
                         // Pad with spaces after the string
                         while (pad--) {
-                            buffer[i++] = ' ';
+                            PUT_CHAR(' ');
                         }
                     } else {
                         // Pad with spaces before the string
                         while (pad--) {
-                            buffer[i++] = ' ';
+                            PUT_CHAR(' ');
                         }
 
                         // Copy the string
                         while (*str) {
-                            buffer[i++] = *str++;
+                            PUT_CHAR(*str++);
                         }
                     }
                     break;
                 }
                 case 'X': alpha = 'A'; // Upper Hex, fallthru
                 case 'x': base = 16; // Lower Hex, fallthru
+                case 'u': // Unsigned, fallthru
                 case 'd': {  // Integer
                     int num = va_arg(args, int);
                     char num_str[20];
-                    format_itoa(num, num_str, base, alpha);
+                    format_itoa(num, num_str, base, alpha, *format == 'd');
                     int len = str_len(num_str);
                     int pad = (width > len) ? width - len : 0;
 
@@ -147,23 +205,23 @@ void __fprintf(zos_dev_t dev, const char* format, va_list args) {
                         // Copy the number string
                         char* num_ptr = num_str;
                         while (*num_ptr) {
-                            buffer[i++] = *num_ptr++;
+                            PUT_CHAR(*num_ptr++);
                         }
 
                         // Pad with spaces after the number
                         while (pad--) {
-                            buffer[i++] = ' ';
+                            PUT_CHAR(' ');
                         }
                     } else {
                         // Pad with spaces before the number
                         while (pad--) {
-                            buffer[i++] = ' ';
+                            PUT_CHAR(' ');
                         }
 
                         // Copy the number string
                         char* num_ptr = num_str;
                         while (*num_ptr) {
-                            buffer[i++] = *num_ptr++;
+                            PUT_CHAR(*num_ptr++);
                         }
                     }
                     break;
@@ -173,7 +231,7 @@ void __fprintf(zos_dev_t dev, const char* format, va_list args) {
                     break;
             }
         } else {
-            buffer[i++] = *format;  // Copy regular characters
+            PUT_CHAR(*format);  // Copy regular characters
         }
         format++;
     }
@@ -185,6 +243,7 @@ void __fprintf(zos_dev_t dev, const char* format, va_list args) {
     uint16_t size = i;
     write(dev, buffer, &size);  // Assume NULL as the device argument
 }
+#endif // ZAR_TINY_PRINTF
 
 void printf(const char* format, ...) {
     va_list args;
@@ -1,24 +1,52 @@
 #!/usr/bin/env python3
 
 import argparse
+import binascii
+import json
+import mmap
 import os
 import re
 import struct
+import sys
+from collections import namedtuple
 from pathlib import Path
 
 parser = argparse.ArgumentParser("zar")
-parser.add_argument("-i", "--input", help="Input Folder", required=True)
+parser.add_argument("-i", "--input", help="Input Folder, or one or more archives with -x/-l/-V", nargs="+", required=True)
 parser.add_argument("-o", "--output", help="Output File", required=False)
 parser.add_argument("-c", "--header", help="Produce a C Header with Indexes", nargs='?', default=False, required=False)
 parser.add_argument("-v", "--verbose", help="Verbose output", action="store_true")
 parser.add_argument("-x", "--extract", help="Extract Input to Output", action="store_true")
 parser.add_argument("-l", "--list", help="List archive files", action="store_true")
+parser.add_argument("-V", "--verify", help="Verify archive structure", action="store_true")
+parser.add_argument("-j", "--json", help="Print list/verify results as JSON", action="store_true")
+parser.add_argument("-r", "--recursive", help="Archive subdirectories", action="store_true")
+parser.add_argument("-t", "--trace", help="Lay the data out in the order of an access trace (ZAR_TRACE file, or index/path lines)", required=False)
+parser.add_argument("-p", "--preload", help="Preload groups, 'name path path ...' lines, stored contiguously", required=False)
+parser.add_argument("-k", "--checksum", help="Write a checksum per entry, lets `zar u` skip unchanged files", action="store_true")
+parser.add_argument("-g", "--video", help="Write video metadata, optionally from a manifest of 'path type [offset]' lines", nargs='?', const=True, default=False)
 
 MAX_ENTRIES = 255
 MAX_BASENAME = 8
 MAX_EXTENSION = 3
 MAX_FILENAME = MAX_BASENAME + MAX_EXTENSION
 FILE_HEADER_SIZE = 4 + MAX_FILENAME  # uint16_t, uint16_t, char[MAX_FILE_NAME]
+FILE_HEADER_SIZE_V1 = FILE_HEADER_SIZE + 1  # uint16_t, uint16_t, uint8_t flags, char[MAX_FILE_NAME]
+ARCHIVE_HEADER_SIZE = 5  # "ZAR", version, file count
+ARCHIVE_HEADER_SIZE_V1 = ARCHIVE_HEADER_SIZE + 2  # root count, flags
+ENTRY_DIR = 0x01
+FLAG_VIDEO = 0x01
+FLAG_GROUPS = 0x02
+FLAG_CHECKSUMS = 0x04
+MAX_GROUPNAME = 8
+GROUP_SIZE = MAX_GROUPNAME + 6  # char[MAX_GROUPNAME], uint16_t position, uint16_t size, uint8_t first, uint8_t count
+GROUP_MEMBER_SIZE = 3  # uint8_t index, uint16_t size
+VIDEO_SIZE = 3  # uint8_t type, uint16_t offset
+ENTRY_NAME = re.compile(r"(?=.)[a-zA-Z0-9]{0,8}(\.[a-zA-Z0-9]{1,3})?")  # what generate_zar_filenames() produces
+CHECKSUM_SIZE = 2  # uint16_t CRC-16/CCITT-FALSE
+VIDEO_TYPES = {"none": 0, "tileset": 1, "palette": 2, "tilemap": 3, "layer0": 3, "layer1": 4}
+VIDEO_REGION_SIZES = {1: 0x10000, 2: 0x200, 3: 0xE00, 4: 0xE00}  # bytes of each video memory, by type
+VIDEO_EXTENSIONS = {".zts": "tileset", ".ztp": "palette", ".ztm": "tilemap"}
 
 
 def create_dir(file_path):
@@ -54,11 +82,11 @@ def process_paths(input_path, output_path):
 
 
 def zar_to_os(filename):
-    return (
-        filename[:MAX_BASENAME].rstrip("\x00")
-        + "."
-        + filename[MAX_BASENAME:].rstrip("\x00")
-    )
+    base = filename[:MAX_BASENAME].rstrip("\x00")
+    ext = filename[MAX_BASENAME:].rstrip("\x00")
+    if not ext:
+        return base
+    return base + "." + ext
 
 
 def generate_zar_filenames(filenames):
@@ -88,6 +116,346 @@ def generate_zar_filenames(filenames):
     return normalized
 
 
+def list_input(path, recursive):
+    # filter out hidden dot files, and directories unless recursive
+    paths = [
+        os.path.abspath(os.path.join(path, name))
+        for name in sorted(os.listdir(path))
+        if not name.startswith(".")
+    ]
+    if not recursive:
+        paths = [path for path in paths if os.path.isfile(path)]
+    return paths
+
+
+def collect_entries(input, recursive):
+    # breadth first, so the children of a directory are contiguous
+    entries = []
+
+    def add(paths):
+        first = len(entries)
+        for src, short_name in generate_zar_filenames(paths).items():
+            entries.append({"src": src, "name": short_name, "dir": os.path.isdir(src), "first": 0, "count": 0})
+        return first, len(paths)
+
+    _, root_count = add(list_input(input, recursive))
+    for entry in entries:
+        if entry["dir"]:
+            entry["first"], entry["count"] = add(list_input(entry["src"], recursive))
+    return entries, root_count
+
+
+def read_video_manifest(input, manifest):
+    # path type [offset], paths are relative to the input folder
+    video = {}
+    with open(manifest, "r") as lines:
+        for line in lines:
+            fields = line.split("#", 1)[0].split()
+            if not fields:
+                continue
+            if len(fields) < 2 or len(fields) > 3 or fields[1] not in VIDEO_TYPES:
+                raise ValueError(f"Invalid video manifest line: {line.strip()}")
+            offset = int(fields[2], 0) if len(fields) > 2 else 0
+            if not 0 <= offset <= 0xFFFF:
+                raise ValueError(f"Invalid video offset: {line.strip()}")
+            video[os.path.abspath(os.path.join(input, fields[0]))] = (VIDEO_TYPES[fields[1]], offset)
+    return video
+
+
+def video_entries(args, entries):
+    # type from the extension, the manifest overrides it
+    manifest = {}
+    if args.video is not True:
+        manifest = read_video_manifest(args.input, args.video)
+
+    video = []
+    for entry in entries:
+        ext = os.path.splitext(entry["src"])[1].lower()
+        default = (VIDEO_TYPES[VIDEO_EXTENSIONS[ext]], 0) if ext in VIDEO_EXTENSIONS and not entry["dir"] else (0, 0)
+        type, offset = manifest.get(entry["src"], default)
+        if type and not entry["dir"] and offset + os.path.getsize(entry["src"]) > VIDEO_REGION_SIZES[type]:
+            raise ValueError(f"{entry['src']} does not fit in its video memory at offset {offset:#x}")
+        video.append((type, offset))
+    return video
+
+
+def read_trace(input, trace, entries):
+    with open(trace, "rb") as file:
+        data = file.read()
+
+    # binary trace from zar_trace_save(): "ZTR", count, indexes
+    if data[:3] == b"ZTR":
+        return list(data[4 : 4 + data[3]])
+
+    # text trace, one index or input relative path per line
+    paths = input_paths(input, entries)
+    order = []
+    for line in data.decode("utf-8").splitlines():
+        line = line.split("#", 1)[0].strip()
+        if not line:
+            continue
+        if line.isdigit():
+            order.append(int(line))
+        elif line in paths:
+            order.append(paths[line])
+        else:
+            raise ValueError(f"Unknown trace entry: {line}")
+    return order
+
+
+def input_paths(input, entries):
+    return {
+        os.path.relpath(entry["src"], os.path.abspath(input)).replace(os.sep, "/"): index
+        for index, entry in enumerate(entries)
+    }
+
+
+def read_groups(input, manifest, entries):
+    # name path path ..., paths are relative to the input folder
+    paths = input_paths(input, entries)
+    groups = []
+    grouped = set()
+    with open(manifest, "r") as lines:
+        for line in lines:
+            fields = line.split("#", 1)[0].split()
+            if not fields:
+                continue
+            name = fields[0]
+            if len(name) > MAX_GROUPNAME or not re.fullmatch(r"[a-zA-Z0-9_]+", name):
+                raise ValueError(f"Invalid group name: {name}")
+            # the -c header upper cases names, they must stay distinct
+            if any(name.upper() == other.upper() for other, _ in groups):
+                raise ValueError(f"Duplicate group name: {name}")
+            members = []
+            for path in fields[1:]:
+                index = paths.get(path)
+                if index is None or entries[index]["dir"]:
+                    raise ValueError(f"Unknown file in group {name}: {path}")
+                if index in grouped:
+                    raise ValueError(f"File in more than one group: {path}")
+                grouped.add(index)
+                members.append(index)
+            groups.append((name, members))
+    return groups
+
+
+def data_order(args, entries, groups):
+    # traced files first in access order, then the rest in index order,
+    # a group is placed as a whole where its first member would be
+    group_of = {index: members for name, members in groups for index in members}
+    candidates = []
+    if args.trace:
+        candidates += read_trace(args.input, args.trace, entries)
+    candidates += range(len(entries))
+
+    order = []
+    for index in candidates:
+        if index >= len(entries) or entries[index]["dir"] or index in order:
+            continue
+        order += group_of.get(index, [index])
+    return order
+
+
+def crc16(data):
+    # CRC-16/CCITT-FALSE, matches zar_checksum()
+    return binascii.crc_hqx(data, 0xFFFF)
+
+
+ZarEntry = namedtuple("ZarEntry", "index name position size flags")
+ZarGroup = namedtuple("ZarGroup", "index name position size members")
+
+
+class ZarReader:
+    """Zero copy view of a ZAR archive, entry data is a memoryview slice of an mmap.
+
+    Slices are only valid until close(), release them before closing.
+    """
+
+    def __init__(self, path):
+        self.path = path
+        self._file = open(path, "rb")
+        try:
+            self._map = mmap.mmap(self._file.fileno(), 0, access=mmap.ACCESS_READ)
+        except ValueError:
+            self._file.close()
+            raise ValueError("Empty archive")
+        self.data = memoryview(self._map)
+        try:
+            self._parse()
+        except ValueError:
+            self.close()
+            raise
+        except (struct.error, IndexError):
+            self.close()
+            raise ValueError("Truncated archive")
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def close(self):
+        self.data.release()
+        try:
+            self._map.close()
+        except BufferError:
+            # slices are still alive, the map is freed along with the last one
+            pass
+        self._file.close()
+
+    def _parse(self):
+        data = self.data
+        if len(data) < ARCHIVE_HEADER_SIZE or data[:3] != b"ZAR":
+            raise ValueError("Not a ZAR archive")
+        self.version, file_count = data[3], data[4]
+        self.root_count, self.flags = file_count, 0
+        offset = ARCHIVE_HEADER_SIZE
+        if self.version >= 1:
+            self.root_count, self.flags = struct.unpack_from("BB", data, offset)
+            offset = ARCHIVE_HEADER_SIZE_V1
+        if self.version > 1:
+            raise ValueError(f"Unsupported version {self.version}")
+
+        self.entries = []
+        for index in range(file_count):
+            position, size = struct.unpack_from("<HH", data, offset)
+            offset += 4
+            flags = 0
+            if self.version >= 1:
+                flags = data[offset]
+                offset += 1
+            name = zar_to_os(bytes(data[offset : offset + MAX_FILENAME]).decode("ascii"))
+            offset += MAX_FILENAME
+            self.entries.append(ZarEntry(index, name, position, size, flags))
+
+        self.video = []
+        if self.flags & FLAG_VIDEO:
+            self.video = [struct.unpack_from("<BH", data, offset + VIDEO_SIZE * i) for i in range(file_count)]
+            offset += VIDEO_SIZE * file_count
+
+        self.checksums = []
+        if self.flags & FLAG_CHECKSUMS:
+            self.checksums = [struct.unpack_from("<H", data, offset + CHECKSUM_SIZE * i)[0] for i in range(file_count)]
+            offset += CHECKSUM_SIZE * file_count
+
+        self.groups = []
+        if self.flags & FLAG_GROUPS:
+            count = data[offset]
+            members = offset + 1 + GROUP_SIZE * count
+            for index in range(count):
+                record = offset + 1 + GROUP_SIZE * index
+                name = bytes(data[record : record + MAX_GROUPNAME]).decode("ascii").rstrip("\x00")
+                position, size, first, member_count = struct.unpack_from("<HHBB", data, record + MAX_GROUPNAME)
+                group_members = [
+                    struct.unpack_from("<BH", data, members + GROUP_MEMBER_SIZE * (first + i)) for i in range(member_count)
+                ]
+                self.groups.append(ZarGroup(index, name, position, size, group_members))
+            offset = members + GROUP_MEMBER_SIZE * sum(len(group.members) for group in self.groups)
+
+        # end of the tables, data can't start before it
+        self.data_start = offset
+        if self.data_start > len(data):
+            raise ValueError("Truncated archive")
+
+    def walk(self, first=0, count=None, prefix=""):
+        if count is None:
+            count = self.root_count
+        for entry in self.entries[first : first + count]:
+            path = prefix + entry.name
+            yield path, entry
+            if entry.flags & ENTRY_DIR:
+                if entry.position <= entry.index:
+                    raise ValueError(f"Invalid directory at index {entry.index}")
+                yield from self.walk(entry.position, entry.size, path + "/")
+
+    def read(self, entry):
+        return self.data[entry.position : entry.position + entry.size]
+
+    def verify(self):
+        errors = []
+        size = len(self.data)
+        if self.root_count > len(self.entries):
+            errors.append(f"root count {self.root_count} past {len(self.entries)} entries")
+
+        seen = set()
+        try:
+            for path, entry in self.walk(0, min(self.root_count, len(self.entries))):
+                if entry.index in seen:
+                    errors.append(f"{path}: entry {entry.index} reached twice")
+                seen.add(entry.index)
+                if entry.flags & ENTRY_DIR and entry.position + entry.size > len(self.entries):
+                    errors.append(f"{path}: children past the last entry")
+        except ValueError as e:
+            errors.append(str(e))
+        if len(seen) != len(self.entries):
+            errors.append(f"{len(self.entries) - len(seen)} entries unreachable from the root")
+
+        for entry in self.entries:
+            if not ENTRY_NAME.fullmatch(entry.name):
+                errors.append(f"entry {entry.index}: invalid name {entry.name!r}")
+
+        spans = []
+        for entry in self.entries:
+            if entry.flags & ENTRY_DIR:
+                continue
+            if entry.position < self.data_start or entry.position + entry.size > size:
+                errors.append(f"entry {entry.index} ({entry.name}): data {entry.position}+{entry.size} outside {self.data_start}..{size}")
+            spans.append((entry.position, entry.position + entry.size, entry.index))
+        spans.sort()
+        for (start, end, index), (next_start, next_end, next_index) in zip(spans, spans[1:]):
+            if next_start < end:
+                errors.append(f"entry {index} overlaps entry {next_index}")
+
+        for index, (type, offset) in enumerate(self.video):
+            if type not in VIDEO_TYPES.values():
+                errors.append(f"entry {index}: unknown video type {type}")
+            elif type and not self.entries[index].flags & ENTRY_DIR and offset + self.entries[index].size > VIDEO_REGION_SIZES[type]:
+                errors.append(f"entry {index}: does not fit in video memory {type} at offset {offset:#x}")
+
+        for index, checksum in enumerate(self.checksums):
+            entry = self.entries[index]
+            if entry.flags & ENTRY_DIR or entry.position + entry.size > size:
+                continue
+            if crc16(self.read(entry)) != checksum:
+                errors.append(f"entry {index} ({entry.name}): checksum mismatch")
+
+        for group in self.groups:
+            position = group.position
+            for index, member_size in group.members:
+                if index >= len(self.entries) or self.entries[index].flags & ENTRY_DIR:
+                    errors.append(f"group {group.name}: invalid member {index}")
+                    break
+                entry = self.entries[index]
+                if entry.position != position or entry.size != member_size:
+                    errors.append(f"group {group.name}: entry {index} is not contiguous")
+                position += member_size
+            if position - group.position != group.size:
+                errors.append(f"group {group.name}: size {group.size} does not match its members")
+        return errors
+
+    def to_dict(self):
+        entries = []
+        for path, entry in self.walk():
+            item = {"index": entry.index, "path": path, "dir": bool(entry.flags & ENTRY_DIR)}
+            if entry.flags & ENTRY_DIR:
+                item["entries"] = entry.size
+            else:
+                item["position"], item["size"] = entry.position, entry.size
+            if self.video and self.video[entry.index][0]:
+                item["video"] = {"type": self.video[entry.index][0], "offset": self.video[entry.index][1]}
+            if self.checksums and not entry.flags & ENTRY_DIR:
+                item["checksum"] = self.checksums[entry.index]
+            entries.append(item)
+        groups = [
+            {"index": group.index, "name": group.name, "position": group.position, "size": group.size,
+             "members": [index for index, size in group.members]}
+            for group in self.groups
+        ]
+        return {"archive": self.path, "version": self.version, "flags": self.flags, "size": len(self.data),
+                "entries": entries, "groups": groups}
+
+
 def archive(args):
     if not args.output:
         print("Output filename required")
@@ -97,22 +465,38 @@ def archive(args):
     create_dir(outputPath)
 
     print("Archiving ", args.input, "to", args.output)
-    # get absolute paths
-    rel_names = sorted(os.listdir(args.input))
-    # filter out hidden dot files
-    filenames = [
-        os.path.abspath(os.path.join(args.input, file))
-        for file in rel_names
-        if not os.path.basename(file).startswith(".")
-    ]
+    entries, root_count = collect_entries(args.input, args.recursive)
 
-    file_count = len(filenames)
+    file_count = len(entries)
     if file_count > MAX_ENTRIES:
         print("ZAR has a", MAX_ENTRIES, "file limit")
         return
 
     header = "ZAR"
-    version = 0
+    flags = 0
+    video = []
+    if args.video:
+        flags |= FLAG_VIDEO
+        video = video_entries(args, entries)
+    checksums = []
+    if args.checksum:
+        flags |= FLAG_CHECKSUMS
+        for entry in entries:
+            if entry["dir"]:
+                checksums.append(0)
+            else:
+                with open(entry["src"], "rb") as input:
+                    checksums.append(crc16(input.read()))
+    groups = []
+    if args.preload:
+        flags |= FLAG_GROUPS
+        groups = read_groups(args.input, args.preload, entries)
+        if len(groups) > MAX_ENTRIES:
+            print("ZAR has a", MAX_ENTRIES, "group limit")
+            return
+
+    # flat archives stay readable by older loaders
+    version = 1 if flags or any(entry["dir"] for entry in entries) else 0
 
     total_size = 0
     position = 0
@@ -121,133 +505,199 @@ def archive(args):
         total_size += output.write(header.encode("ascii"))
         total_size += output.write(struct.pack("B", version))
         total_size += output.write(struct.pack("B", file_count))
+        if version >= 1:
+            total_size += output.write(struct.pack("B", root_count))
+            total_size += output.write(struct.pack("B", flags))
+
+        entry_size = FILE_HEADER_SIZE_V1 if version >= 1 else FILE_HEADER_SIZE
+        position = total_size + (entry_size * file_count) + (VIDEO_SIZE * len(video)) + (CHECKSUM_SIZE * len(checksums))
+        if groups:
+            members = sum(len(group_members) for name, group_members in groups)
+            position += 1 + (GROUP_SIZE * len(groups)) + (GROUP_MEMBER_SIZE * members)
+
+        # the data order is free, entry indexes never change
+        order = data_order(args, entries, groups)
+        positions = {}
+        for index in order:
+            positions[index] = position
+            # add the filesize to pointer
+            position += os.path.getsize(entries[index]["src"])
 
-        zar_files = generate_zar_filenames(filenames)
-
-        position = total_size + (FILE_HEADER_SIZE * len(zar_files))
-        for src, short_name in zar_files.items():
-            size = os.path.getsize(src)
-            short = short_name.encode("ascii")
+        for index, entry in enumerate(entries):
+            short = entry["name"].encode("ascii")
+            if entry["dir"]:
+                # directories point at their children
+                pointer, size, entry_flags = entry["first"], entry["count"], ENTRY_DIR
+            else:
+                pointer, size, entry_flags = positions[index], os.path.getsize(entry["src"]), 0
 
             # start position of file
-            total_size += output.write(struct.pack("<H", position))
+            total_size += output.write(struct.pack("<H", pointer))
             # size of the file
             total_size += output.write(struct.pack("<H", size))
+            if version >= 1:
+                total_size += output.write(struct.pack("B", entry_flags))
             total_size += output.write(short)
 
             if args.verbose:
-                print(position, size, short)
-
-            # add the filesize to pointer
-            position += size
-
-        for src, short_name in zar_files.items():
-            with open(src, "rb") as input:
+                print(pointer, size, short)
+
+        for type, offset in video:
+            total_size += output.write(struct.pack("<BH", type, offset))
+
+        for checksum in checksums:
+            total_size += output.write(struct.pack("<H", checksum))
+
+        if groups:
+            total_size += output.write(struct.pack("B", len(groups)))
+            first = 0
+            for name, members in groups:
+                start = positions[members[0]] if members else 0
+                size = sum(os.path.getsize(entries[index]["src"]) for index in members)
+                total_size += output.write(name.encode("ascii").ljust(MAX_GROUPNAME, b"\x00"))
+                total_size += output.write(struct.pack("<HHBB", start, size, first, len(members)))
+                first += len(members)
+            for name, members in groups:
+                for index in members:
+                    total_size += output.write(struct.pack("<BH", index, os.path.getsize(entries[index]["src"])))
+
+        for index in order:
+            with open(entries[index]["src"], "rb") as input:
                 total_size += output.write(input.read())
 
     return args.output
 
 
-def extract(args):
-    if not args.list and not args.output:
-        print("Output folder required")
-        return
-
-    print("Extracting ", args.input, "to", args.output)
-    if not args.list:
-        os.makedirs(args.output, exist_ok=True)
+def log(args, *values):
+    # with -j stdout only carries the JSON report
+    print(*values, file=sys.stderr if args.json else sys.stdout)
 
-    with open(args.input, "rb") as input:
-        header = input.read(3).decode("ascii")
-        version = ord(input.read(1))
-        file_count = ord(input.read(1))
 
-        print(header, version, file_count)
-
-        files = {}
+def extract(args, reader, output_dir):
+    if not args.list and not output_dir:
+        log(args, "Output folder required")
+        return
 
-        for i in range(file_count):
-            data = input.read(2)
-            pointer = struct.unpack("<H", data)[0]
-            data = input.read(2)
-            size = struct.unpack("<H", data)[0]
-            data = input.read(MAX_FILENAME)
-            short = data.decode("ascii").rstrip("\x00")
+    log(args, "Extracting ", reader.path, "to", output_dir)
+    if not args.list:
+        os.makedirs(output_dir, exist_ok=True)
+        root = os.path.realpath(output_dir)
 
-            files[short] = (pointer, size)
+    log(args, "ZAR", reader.version, len(reader.entries))
 
+    if args.verbose or args.list:
+        log(args, "Index".ljust(5), "Filename".ljust(MAX_FILENAME + 1), "Size".rjust(6), "Pos".rjust(5))
+        log(args, "".ljust(5, "-"), "".ljust(MAX_FILENAME + 1, "-"), "".rjust(6, "-"), "".rjust(5, "-"))
+    for path, entry in reader.walk():
+        is_dir = entry.flags & ENTRY_DIR
         if args.verbose or args.list:
-            print("Index".ljust(5), "Filename".ljust(MAX_FILENAME + 1), "Size".rjust(6), "Pos".rjust(5))
-            print("".ljust(5, "-"), "".ljust(MAX_FILENAME + 1, "-"), "".rjust(6, "-"), "".rjust(5, "-"))
-        for index, (short, data) in enumerate(files.items()):
-            short_name = zar_to_os(short)
-            pointer, size = data
-            input.seek(pointer)
-            data = input.read(size)
-            if args.verbose or args.list:
-                print(
-                    str(index).rjust(5),
-                    short_name.ljust(MAX_FILENAME + 1),
-                    str(size).rjust(5) + "B",
-                    str(pointer).rjust(5),
-                )
-            if not args.list:
-                with open(os.path.join(args.output, short_name), "wb") as output:
-                    output.write(data)
-
-
-def create_c_header(args, inputFile):
+            log(args, 
+                str(entry.index).rjust(5),
+                (path + "/" if is_dir else path).ljust(MAX_FILENAME + 1),
+                ("" if is_dir else str(entry.size) + "B").rjust(6),
+                ("" if is_dir else str(entry.position)).rjust(5),
+            )
+        if args.list:
+            continue
+        # never write outside the output directory, whatever the names hold
+        if os.path.commonpath([root, os.path.realpath(os.path.join(output_dir, path))]) != root:
+            raise ValueError(f"{path}: outside the output directory")
+        if is_dir:
+            os.makedirs(os.path.join(output_dir, path), exist_ok=True)
+            continue
+        with open(os.path.join(output_dir, path), "wb") as output, reader.read(entry) as data:
+            output.write(data)
+
+
+def create_c_header(args, reader):
     headerFile = args.header
     if not headerFile:
         headerFile = 'zar.h'
 
-    print("Generating C Header", headerFile)
+    log(args, "Generating C Header", headerFile)
     with open(headerFile, "w") as output:
-        with open(inputFile, "rb") as input:
-            input.seek(0, os.SEEK_END)
-            size = input.tell()
-            input.seek(0, os.SEEK_SET)
-            header = input.read(3).decode("ascii")
-            version = ord(input.read(1))
-            file_count = ord(input.read(1))
-
-            output.write("/**\n")
-            output.write(" * ZAR File Header\n")
-            output.write(f" * {header}{version}: {file_count} files, {size} bytes\n")
-            output.write(" */\n\n")
-
-            for i in range(file_count):
-                data = input.read(2)
-                pointer = struct.unpack("<H", data)[0]
-                data = input.read(2)
-                size = struct.unpack("<H", data)[0]
-                data = input.read(MAX_FILENAME)
-                short = data.decode("ascii").rstrip("\x00")
-                short = zar_to_os(short)
-
-                # Remove extension and get the base name
-                macro = re.sub(r'[^a-zA-Z0-9]', '_', short)  # Replace non-alphanumeric characters with '_'
-                macro = macro.upper()  # Convert to uppercase
-                macro = f"ZAR_{macro}"
-
-                output.write(f"#define {macro.ljust(24)} {i}\t\t// at {pointer}, {size} bytes\n")
+        output.write("/**\n")
+        output.write(" * ZAR File Header\n")
+        output.write(f" * ZAR{reader.version}: {len(reader.entries)} files, {len(reader.data)} bytes\n")
+        output.write(" */\n\n")
+
+        for path, entry in reader.walk():
+            # Replace non-alphanumeric characters with '_'
+            macro = re.sub(r'[^a-zA-Z0-9]', '_', path)
+            macro = macro.upper()  # Convert to uppercase
+            macro = f"ZAR_{macro}"
+
+            if entry.flags & ENTRY_DIR:
+                output.write(f"#define {macro.ljust(24)} {entry.index}\t\t// directory, {entry.size} entries\n")
+            else:
+                output.write(f"#define {macro.ljust(24)} {entry.index}\t\t// at {entry.position}, {entry.size} bytes\n")
+
+        if reader.groups:
+            output.write("\n")
+        for group in reader.groups:
+            macro = f"ZAR_GROUP_{group.name.upper()}"
+            output.write(f"#define {macro.ljust(24)} {group.index}\t\t// at {group.position}, {group.size} bytes, {len(group.members)} entries\n")
+
+
+def inspect(args):
+    # one or more archives, in a single process
+    if not args.header == False and len(args.input) > 1:
+        print("-c takes a single archive")
+        return 1
+    results = []
+    failed = False
+    for path in args.input:
+        output_dir = args.output
+        if output_dir and len(args.input) > 1:
+            output_dir = os.path.join(output_dir, Path(path).stem)
+
+        result = {"archive": path}
+        try:
+            with ZarReader(path) as reader:
+                if args.json:
+                    result = reader.to_dict()
+                if args.verify:
+                    result["errors"] = reader.verify()
+                    failed |= bool(result["errors"])
+                    if not args.json:
+                        for error in result["errors"]:
+                            print(f"{path}: {error}")
+                        print(f"{path}: {'FAILED' if result['errors'] else 'OK'}")
+                if args.extract or (args.list and not args.json):
+                    extract(args, reader, output_dir)
+                if not args.header == False:
+                    create_c_header(args, reader)
+        except (OSError, ValueError) as e:
+            result["errors"] = [str(e)]
+            failed = True
+            if not args.json:
+                print(f"{path}: {e}")
+        results.append(result)
+
+    if args.json:
+        print(json.dumps(results, indent=2))
+    return 1 if failed else 0
 
 
 def main():
     args = parser.parse_args()
-    print("args", args)
+    if not args.json:
+        print("args", args)
 
-    inputFile = args.input
-
-    if not args.extract and not args.list:
-        inputFile = archive(args)
-    else:
-        extract(args)
+    if args.extract or args.list or args.verify:
+        return inspect(args)
 
-    if not args.header == False:
-        create_c_header(args, inputFile)
+    if len(args.input) != 1:
+        print("One input folder required")
+        return 1
+    args.input = args.input[0]
 
+    inputFile = archive(args)
+    if inputFile and not args.header == False:
+        with ZarReader(inputFile) as reader:
+            create_c_header(args, reader)
+    return 0
 
 
 if __name__ == "__main__":
-    main()
+    sys.exit(main())